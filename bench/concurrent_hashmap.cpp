@@ -0,0 +1,65 @@
+// lookup throughput of concurrent_hashmap at 1, 2, 4 ... threads, against one hashmap behind a shared_mutex;
+// g++ -std=c++20 -O2 -I. bench/concurrent_hashmap.cpp -o /tmp/bench && /tmp/bench [max threads] [writes per 1000 ops]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <shared_mutex>
+#include <thread>
+#include "libzx/vector.hpp"
+#include "libzx/concurrent_hashmap.hpp"
+
+using namespace libzx;
+
+static constexpr uint64_t keys = 1 << 20, ops = 1 << 22;
+
+// runs ops operations on each of n threads and returns millions of operations per second in total;
+double run(size_t n, auto&& op) {
+    vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < n; t++) {
+        threads.push_back(std::thread([&op, t] {
+            uint64_t x = 0x9E3779B97F4A7C15 * (t + 1);
+            for (uint64_t i = 0; i < ops; i++) {
+                x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+                op(x);
+            }
+        }));
+    }
+    for (auto& t : threads) t.join();
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return n * ops / s / 1e6;
+}
+
+int main(int argc, char** argv) {
+    size_t max = argc > 1 ? atoi(argv[1]) : std::thread::hardware_concurrency();
+    uint64_t writes = argc > 2 ? atoi(argv[2]) : 10;
+
+    concurrent_hashmap<uint64_t, uint64_t> map;
+    hashmap<uint64_t, uint64_t> plain;
+    std::shared_mutex lock;
+    for (uint64_t k = 0; k < keys; k++) map.set(k, k), plain.set(k, k);
+
+    printf("%llu keys, %llu writes per 1000 operations, %u hardware threads\n",
+        (unsigned long long)keys, (unsigned long long)writes, std::thread::hardware_concurrency());
+    printf("threads  concurrent_hashmap  shared_mutex hashmap  (Mops/s, and speedup over 1 thread)\n");
+    double base[2] = {};
+    for (size_t n = 1; n <= max; n *= 2) {
+        double a = run(n, [&](uint64_t x) {
+            auto k = x % keys;
+            if (x % 1000 < writes) map.set(k, x);
+            else if (!map.get(k)) abort();
+        });
+        double b = run(n, [&](uint64_t x) {
+            auto k = x % keys;
+            if (x % 1000 < writes) {
+                std::unique_lock l(lock);
+                plain.set(k, x);
+            } else {
+                std::shared_lock l(lock);
+                if (!plain.contains(k)) abort();
+            }
+        });
+        if (n == 1) base[0] = a, base[1] = b;
+        printf("%7zu  %10.1f %5.2fx  %10.1f %5.2fx\n", n, a, a / base[0], b, b / base[1]);
+    }
+}
@@ -0,0 +1,55 @@
+// get_many against a loop of get, for random hits on a hashmap much larger than the cache;
+// g++ -std=c++20 -O2 -I. bench/hashmap_bulk.cpp -o /tmp/bench && /tmp/bench [entries] [lookups]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include "libzx/vector.hpp"
+#include "libzx/hashmap.hpp"
+
+using namespace libzx;
+
+using result = std::optional<std::reference_wrapper<long>>;
+
+// the best of five runs of f, in seconds;
+double best(auto&& f) {
+    double min = 1e9;
+    for (int r = 0; r < 5; r++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        min = std::min(min, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return min;
+}
+
+int main(int argc, char** argv) {
+    size_t entries = argc > 1 ? atoll(argv[1]) : 1 << 24;
+    size_t lookups = argc > 2 ? atoll(argv[2]) : 1 << 23;
+
+    hashmap<long, long> map;
+    map.reserve(entries);
+    for (size_t k = 0; k < entries; k++) map.set((long)k, (long)k);
+
+    vector<long> keys(lookups);
+    uint64_t x = 0x9E3779B97F4A7C15;
+    for (auto& k : keys) {
+        x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+        k = (long)(x % entries);
+    }
+    vector<result> out(lookups);
+
+    double loop = best([&] {
+        for (size_t i = 0; i < lookups; i++) out[i] = map.get(keys[i]);
+    });
+    long check = 0;
+    for (auto& r : out) check += r->get();
+    double many = best([&] {
+        map.get_many(keys, out);
+    });
+    for (auto& r : out) check -= r->get();
+    if (check != 0) abort();
+
+    printf("%zu entries, %zu random hits\n", entries, lookups);
+    printf("get loop  %6.1f ns per key\n", loop / lookups * 1e9);
+    printf("get_many  %6.1f ns per key  (%.2fx)\n", many / lookups * 1e9, loop / many);
+}
@@ -0,0 +1,33 @@
+// lookups of missing keys in a hashmap while its keys are removed and inserted over and over;
+// g++ -std=c++20 -O2 -I. bench/hashmap_churn.cpp -o /tmp/bench && /tmp/bench [cycles]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "libzx/hashmap.hpp"
+
+using namespace libzx;
+
+static constexpr uint64_t live = 100000, misses = 100000, rounds = 20;
+
+int main(int argc, char** argv) {
+    uint64_t cycles = argc > 1 ? atoll(argv[1]) : 10000000;
+
+    // the live keys are a window of consecutive numbers that moves up by one every cycle;
+    hashmap<uint64_t, uint64_t> map;
+    for (uint64_t k = 0; k < live; k++) map.set(k, k);
+
+    printf("%llu live keys, %llu remove/insert cycles\n", (unsigned long long)live, (unsigned long long)cycles);
+    printf("cycles  ns per missed lookup\n");
+    uint64_t next = live, found = 0;
+    for (uint64_t r = 1; r <= rounds; r++) {
+        for (; next < live + cycles * r / rounds; next++) {
+            map.remove(next - live);
+            map.set(next, next);
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < misses; i++) found += map.contains(next + 1 + i * 0x9E3779B9);
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%9llu  %6.1f\n", (unsigned long long)(next - live), s / misses * 1e9);
+    }
+    if (found != 0 || map.size() != live) abort();
+}
@@ -0,0 +1,78 @@
+// throughput of find, count, min_max, sum, dot and all, against the portable loops they fall back to;
+// g++ -std=c++20 -O2 -I. bench/kernels.cpp -o /tmp/bench && /tmp/bench [megabytes]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "libzx/vector.hpp"
+#include "libzx/algorithm.hpp"
+
+using namespace libzx;
+
+volatile size_t sink;
+
+// the best of five runs of f, in GB/s over bytes;
+double gbs(size_t bytes, auto&& f) {
+    double min = 1e9;
+    f();
+    for (int r = 0; r < 5; r++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        min = std::min(min, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return bytes / min / 1e9;
+}
+
+void row(const char* name, size_t bytes, auto&& vector, auto&& scalar) {
+    printf("%-12s %6.1f  %6.1f\n", name, gbs(bytes, vector), gbs(bytes, scalar));
+}
+
+int main(int argc, char** argv) {
+    size_t size = (argc > 1 ? atoll(argv[1]) : 256) << 20;
+
+    // inputs in which nothing is found, so that every kernel reads all of them;
+    vector<uint8_t> bytes(size), copy(size);
+    vector<uint32_t> words(size / 4);
+    vector<int32_t> ints(size / 4);
+    vector<float> floats(size / 4);
+    for (auto& b : bytes) b = 1;
+    for (auto& w : words) w = 7;
+    for (auto& i : ints) i = 3;
+    for (auto& f : floats) f = 1.5f;
+    slice<uint8_t> b(bytes);
+    slice<uint32_t> w(words);
+    slice<int32_t> i(ints);
+    slice<float> f(floats);
+
+#ifdef LIBZX_DISPATCH
+    const char* names[] = { "SSE2", "AVX2", "AVX-512" };
+    printf("%zu MB inputs, %s\n", size >> 20, names[kernels::level()]);
+#else
+    printf("%zu MB inputs, no vector instructions\n", size >> 20);
+#endif
+    // the bandwidth that the kernels are bound by, counting the bytes read and written;
+    printf("memcpy       %6.1f GB/s\n", gbs(2 * size, [&] { memcpy(copy.begin(), bytes.begin(), size); sink = copy[5]; }));
+    printf("GB/s         vector  scalar\n");
+    row("count u8", size,
+        [&] { sink = count(b, (uint8_t)2); },
+        [&] { sink = kernels::scalar::run(kernels::count{}, b.begin(), b.size(), (uint8_t)2); });
+    row("find u32", size,
+        [&] { sink = (size_t)find(w, 9u); },
+        [&] { sink = kernels::scalar::run(kernels::find{}, w.begin(), w.size(), 9u, true); });
+    row("min_max f32", size,
+        [&] { sink = (size_t)min_max(f).first; },
+        [&] { sink = (size_t)kernels::scalar::run(kernels::min_max{}, f.begin(), f.size()).first; });
+    row("sum u8", size,
+        [&] { sink = (size_t)sum(b); },
+        [&] { sink = (size_t)kernels::scalar::run(kernels::sum{}, b.begin(), b.size()); });
+    row("sum i32", size,
+        [&] { sink = (size_t)sum(i); },
+        [&] { sink = (size_t)kernels::scalar::run(kernels::sum{}, i.begin(), i.size()); });
+    // counts the bytes of both inputs;
+    row("dot f32", 2 * size,
+        [&] { sink = (size_t)dot(f, f); },
+        [&] { sink = (size_t)kernels::scalar::run(kernels::dot{}, f.begin(), f.begin(), f.size()); });
+    row("all u8", size,
+        [&] { sink = all(b); },
+        [&] { sink = kernels::scalar::run(kernels::find{}, b.begin(), b.size(), (uint8_t)0, true); });
+}
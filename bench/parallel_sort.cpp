@@ -0,0 +1,42 @@
+// parallel_sort of random longs at 1, 2, 4 ... threads, against sort;
+// g++ -std=c++20 -O2 -I. bench/parallel_sort.cpp -o /tmp/bench && /tmp/bench [count] [max threads]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include "libzx/vector.hpp"
+#include "libzx/algorithm.hpp"
+
+using namespace libzx;
+
+// sorts a copy of input with f, checks that it is in order and returns the seconds taken;
+double run(const vector<long>& input, auto&& f) {
+    vector<long> v = input;
+    auto start = std::chrono::steady_clock::now();
+    f(slice<long>(v));
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (size_t i = 1; i < v.size(); i++) {
+        if (v[i] < v[i - 1]) abort();
+    }
+    return s;
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? atoll(argv[1]) : 10000000;
+    size_t max = argc > 2 ? atoi(argv[2]) : std::thread::hardware_concurrency();
+
+    vector<long> input(n);
+    uint64_t x = 0x9E3779B97F4A7C15;
+    for (auto& v : input) {
+        x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+        v = (long)x;
+    }
+
+    printf("%zu random longs, %u hardware threads\n", n, std::thread::hardware_concurrency());
+    double base = run(input, [](slice<long> s) { sort(s); });
+    printf("sort           %8.0f ms\n", base * 1e3);
+    for (size_t t = 1; t <= std::max<size_t>(max, 1); t *= 2) {
+        double s = run(input, [t](slice<long> s) { parallel_sort(s, t); });
+        printf("%2zu threads     %8.0f ms  %5.2fx\n", t, s * 1e3, base / s);
+    }
+}
@@ -0,0 +1,66 @@
+// random lookups in sorted keys: a textbook binary search, std::lower_bound, lower_bound and static_search_index;
+// g++ -std=c++20 -O2 -I. bench/search.cpp -o /tmp/bench && /tmp/bench [largest key count]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "libzx/vector.hpp"
+#include "libzx/algorithm.hpp"
+#include "libzx/static_search_index.hpp"
+
+using namespace libzx;
+
+static constexpr size_t queries = 4000000;
+
+volatile size_t sink;
+
+// a binary search with a branch at every level;
+[[gnu::noinline]] const uint32_t* classic(const uint32_t* b, size_t n, uint32_t x) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (b[mid] < x) lo = mid + 1;
+        else hi = mid;
+    }
+    return b + lo;
+}
+
+// runs f once and returns the nanoseconds it took per query;
+double ns(auto&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / queries * 1e9;
+}
+
+int main(int argc, char** argv) {
+    size_t max = argc > 1 ? atoll(argv[1]) : 100000000;
+
+    uint64_t x = 0x9E3779B97F4A7C15;
+    auto random = [&] { return (uint32_t)(x ^= x << 13, x ^= x >> 7, x ^= x << 17); };
+    vector<uint32_t> q(queries);
+    for (auto& k : q) k = random();
+
+    printf("uint32_t keys, %zu random lookups, ns per lookup\n", queries);
+    printf("keys        classic  std::lower_bound  lower_bound  static_search_index  build (s)\n");
+    for (size_t n = 10000; n <= max; n *= n < 1000000 ? 100 : 10) {
+        vector<uint32_t> keys(n);
+        for (auto& k : keys) k = random();
+        std::sort(keys.begin(), keys.end());
+        slice<uint32_t> s(keys);
+
+        auto start = std::chrono::steady_clock::now();
+        static_search_index<uint32_t> index(s);
+        double build = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // every search must find the same key;
+        size_t sums[4] = {};
+        double a = ns([&] { for (auto k : q) { auto p = classic(s.begin(), n, k); sums[0] += p == s.end() ? 0 : *p; } });
+        double b = ns([&] { for (auto k : q) { auto p = std::lower_bound(s.begin(), s.end(), k); sums[1] += p == s.end() ? 0 : *p; } });
+        double c = ns([&] { for (auto k : q) { auto p = lower_bound(s, k); sums[2] += p == s.end() ? 0 : *p; } });
+        double d = ns([&] { for (auto k : q) { auto p = index.lower_bound(k); sums[3] += p ? *p : 0; } });
+        if (sums[1] != sums[0] || sums[2] != sums[0] || sums[3] != sums[0]) abort();
+        sink = sums[0];
+
+        printf("%-10zu %8.0f %17.0f %12.0f %20.0f %10.2f\n", n, a, b, c, d, build);
+    }
+}
@@ -0,0 +1,35 @@
+// building and summing a short container, as vector and as small_vector;
+// g++ -std=c++20 -O2 -I. bench/small_vector.cpp -o /tmp/bench && /tmp/bench [rounds] [length]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "libzx/vector.hpp"
+#include "libzx/small_vector.hpp"
+
+using namespace libzx;
+
+volatile long sink;
+
+// builds a container of n ints in each of rounds rounds and sums it, and returns the seconds taken;
+template<typename V>
+double run(size_t rounds, size_t n) {
+    long total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; r++) {
+        V v;
+        for (size_t i = 0; i < n; i++) v.push_back((int)(r + i));
+        for (auto x : v) total += x;
+    }
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    sink = total;
+    return s;
+}
+
+int main(int argc, char** argv) {
+    size_t rounds = argc > 1 ? atoll(argv[1]) : 10000000;
+    size_t n = argc > 2 ? atoll(argv[2]) : 6;
+
+    printf("%zu rounds of %zu ints\n", rounds, n);
+    printf("vector<int>           %.3f s\n", run<vector<int>>(rounds, n));
+    printf("small_vector<int, 8>  %.3f s\n", run<small_vector<int, 8>>(rounds, n));
+}
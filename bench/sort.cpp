@@ -0,0 +1,47 @@
+// sort against std::sort on ints in random, sorted, reversed, all equal, few distinct and organ pipe order;
+// g++ -std=c++20 -O2 -I. bench/sort.cpp -o /tmp/bench && /tmp/bench [count]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "libzx/vector.hpp"
+#include "libzx/algorithm.hpp"
+
+using namespace libzx;
+
+// sorts a copy of input with f, checks it against expected and returns the seconds taken;
+double run(const vector<int>& input, const vector<int>& expected, auto&& f) {
+    vector<int> v = input;
+    auto start = std::chrono::steady_clock::now();
+    f(slice<int>(v));
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!std::equal(v.begin(), v.end(), expected.begin())) abort();
+    return s;
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? atoll(argv[1]) : 10000000;
+
+    uint64_t x = 0x9E3779B97F4A7C15;
+    auto random = [&] { return x ^= x << 13, x ^= x >> 7, x ^= x << 17; };
+    struct { const char* name; int (*make)(size_t i, size_t n, uint64_t r); } inputs[] = {
+        { "random", [](size_t, size_t, uint64_t r) { return (int)r; } },
+        { "sorted", [](size_t i, size_t, uint64_t) { return (int)i; } },
+        { "reversed", [](size_t i, size_t n, uint64_t) { return (int)(n - i); } },
+        { "all equal", [](size_t, size_t, uint64_t) { return 7; } },
+        { "16 distinct", [](size_t, size_t, uint64_t r) { return (int)(r % 16); } },
+        { "organ pipe", [](size_t i, size_t n, uint64_t) { return (int)(i < n / 2 ? i : n - i); } },
+    };
+
+    printf("%zu ints, seconds\n", n);
+    printf("input        libzx::sort  std::sort\n");
+    for (auto& in : inputs) {
+        vector<int> input(n);
+        for (size_t i = 0; i < n; i++) input[i] = in.make(i, n, random());
+        vector<int> expected = input;
+        std::sort(expected.begin(), expected.end());
+        double a = run(input, expected, [](slice<int> s) { sort(s); });
+        double b = run(input, expected, [](slice<int> s) { std::sort(s.begin(), s.end()); });
+        printf("%-11s  %10.3f  %9.3f\n", in.name, a, b);
+    }
+}
@@ -0,0 +1,55 @@
+// throughput of split and split_csv over a large csv-like buffer;
+// g++ -std=c++20 -O2 -I. bench/split.cpp -o /tmp/bench && /tmp/bench [megabytes]
+// add -DLIBZX_NO_SIMD to measure the table lookup instead of the vector compares;
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "libzx/vector.hpp"
+#include "libzx/split.hpp"
+
+using namespace libzx;
+
+// the best of three runs of f, in GB/s over bytes;
+double gbs(size_t bytes, auto&& f) {
+    double min = 1e9;
+    for (int r = 0; r < 3; r++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        min = std::min(min, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return bytes / min / 1e9;
+}
+
+int main(int argc, char** argv) {
+    size_t size = (argc > 1 ? atoll(argv[1]) : 200) << 20;
+
+    // rows of numbers, words and quoted text with commas in it, of a few to a few dozen bytes a field;
+    const char* fields[] = { "12345", "alpha", "\"quoted, with a comma\"", "", "3.14159", "a much longer field of plain text" };
+    vector<char> buf;
+    buf.reserve(size + 64);
+    uint64_t x = 0x9E3779B97F4A7C15;
+    size_t cols = 0;
+    for (; buf.size() < size; cols++) {
+        x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+        for (const char* c = fields[x % 6]; *c; c++) buf.push_back(*c);
+        buf.push_back(cols % 8 == 7 ? '\n' : ',');
+    }
+    slice<char> s(buf);
+
+    size_t n = 0, m = 0;
+    double a = gbs(s.size(), [&] {
+        n = 0;
+        for (auto f : split(s, ",\n")) n += f.size() + 1;
+    });
+    double b = gbs(s.size(), [&] {
+        m = 0;
+        for ([[maybe_unused]] auto f : split_csv(s, ",\n")) m++;
+    });
+    // a delimiter ends the buffer, so an empty field follows it;
+    if (n != s.size() + 1 || m != cols + 1) abort();
+
+    printf("%zu MB, %zu csv fields\n", s.size() >> 20, m);
+    printf("split      %5.2f GB/s\n", a);
+    printf("split_csv  %5.2f GB/s\n", b);
+}
@@ -1,41 +1,537 @@
 #pragma once
+#include <bit>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <concepts>
+#include <stdexcept>
 #include <functional>
+#include <type_traits>
 #include "slice.hpp"
+#include "probe.hpp"
+#include "vector.hpp"
+#include "kernels.hpp"
+#include "smart_array.hpp"
 
 namespace libzx {
 
+// pieces of the sorts below, on raw ranges [b, e);
+namespace sorting {
+    constexpr ptrdiff_t insertion_limit = 24, ninther_limit = 128;
+    constexpr size_t partial_limit = 8, run = 32;
+
+    template<typename T>
+    void insertion(T* b, T* e, auto& less) {
+        if (b == e) return;
+        for (auto i = b + 1; i < e; i++) {
+            if (!less(*i, i[-1])) continue;
+            T t = std::move(*i);
+            auto j = i;
+            do { *j = std::move(j[-1]); j--; } while (j > b && less(t, j[-1]));
+            *j = std::move(t);
+        }
+    }
+
+    // needs b[-1] to be no greater than any element of the range, which stops every element;
+    template<typename T>
+    void unguarded_insertion(T* b, T* e, auto& less) {
+        if (b == e) return;
+        for (auto i = b + 1; i < e; i++) {
+            if (!less(*i, i[-1])) continue;
+            T t = std::move(*i);
+            auto j = i;
+            do { *j = std::move(j[-1]); j--; } while (less(t, j[-1]));
+            *j = std::move(t);
+        }
+    }
+
+    // sorts a range that is hopefully sorted already, giving up after a few moves;
+    template<typename T>
+    bool partial_insertion(T* b, T* e, auto& less) {
+        if (b == e) return true;
+        size_t moves = 0;
+        for (auto i = b + 1; i < e; i++) {
+            if (!less(*i, i[-1])) continue;
+            T t = std::move(*i);
+            auto j = i;
+            do { *j = std::move(j[-1]); j--; } while (j > b && less(t, j[-1]));
+            *j = std::move(t);
+            moves += i - j;
+            if (moves > partial_limit) return false;
+        }
+        return true;
+    }
+
+    template<typename T>
+    void sort3(T* a, T* b, T* c, auto& less) {
+        if (less(*b, *a)) std::swap(*a, *b);
+        if (less(*c, *b)) {
+            std::swap(*b, *c);
+            if (less(*b, *a)) std::swap(*a, *b);
+        }
+    }
+
+    template<typename T>
+    void sift_down(T* b, size_t n, size_t i, auto& less) {
+        T t = std::move(b[i]);
+        for (size_t c; (c = 2 * i + 1) < n; i = c) {
+            if (c + 1 < n && less(b[c], b[c + 1])) c++;
+            if (!less(t, b[c])) break;
+            b[i] = std::move(b[c]);
+        }
+        b[i] = std::move(t);
+    }
+
+    template<typename T>
+    void make_heap(T* b, size_t n, auto& less) {
+        for (size_t i = n / 2; i-- > 0;) sift_down(b, n, i, less);
+    }
+
+    template<typename T>
+    void heap_sort(T* b, T* e, auto& less) {
+        size_t n = e - b;
+        make_heap(b, n, less);
+        for (size_t i = n; i-- > 1;) {
+            std::swap(b[0], b[i]);
+            sift_down(b, i, 0, less);
+        }
+    }
+
+    // partitions around the pivot at b, putting elements equal to it on the right;
+    // needs an element no less than the pivot after b, and reports whether nothing had to move;
+    template<typename T>
+    auto partition_right(T* b, T* e, auto& less) -> std::pair<T*, bool> {
+        T pivot = std::move(*b);
+        auto first = b, last = e;
+        while (less(*++first, pivot));
+        if (first - 1 == b) while (first < last && !less(*--last, pivot));
+        else while (!less(*--last, pivot));
+        bool already = first >= last;
+        while (first < last) {
+            std::swap(*first, *last);
+            while (less(*++first, pivot));
+            while (!less(*--last, pivot));
+        }
+        auto p = first - 1;
+        *b = std::move(*p);
+        *p = std::move(pivot);
+        return { p, already };
+    }
+
+    // partitions around the pivot at b, putting elements equal to it on the left;
+    // used when b[-1] equals the pivot, so that runs of equal elements are passed over at once;
+    template<typename T>
+    T* partition_left(T* b, T* e, auto& less) {
+        T pivot = std::move(*b);
+        auto first = b, last = e;
+        while (less(pivot, *--last));
+        if (last + 1 == e) while (first < last && !less(pivot, *++first));
+        else while (!less(pivot, *++first));
+        while (first < last) {
+            std::swap(*first, *last);
+            while (less(pivot, *--last));
+            while (!less(pivot, *++first));
+        }
+        *b = std::move(*last);
+        *last = std::move(pivot);
+        return last;
+    }
+
+    // moves the median of a sample to b, with an element no less than it left at e[-1];
+    template<typename T>
+    void choose_pivot(T* b, T* e, auto& less) {
+        auto h = (e - b) / 2;
+        if (e - b > ninther_limit) {
+            sort3(b, b + h, e - 1, less);
+            sort3(b + 1, b + (h - 1), e - 2, less);
+            sort3(b + 2, b + (h + 1), e - 3, less);
+            sort3(b + (h - 1), b + h, b + (h + 1), less);
+            std::swap(*b, b[h]);
+        } else {
+            sort3(b + h, b, e - 1, less);
+        }
+    }
+
+    // pattern-defeating quicksort: quicksort that recurses into the smaller side only,
+    // finishes sorted-looking partitions by insertion, shuffles around unbalanced ones,
+    // and falls back to heap sort after `bad` of them, which bounds it to O(n log n);
+    template<typename T>
+    void pdq(T* b, T* e, auto& less, int bad, bool leftmost) {
+        for (;;) {
+            auto n = e - b;
+            if (n < insertion_limit) {
+                if (leftmost) insertion(b, e, less);
+                else unguarded_insertion(b, e, less);
+                return;
+            }
+            choose_pivot(b, e, less);
+            if (!leftmost && !less(b[-1], *b)) {
+                b = partition_left(b, e, less) + 1;
+                continue;
+            }
+            auto [p, already] = partition_right(b, e, less);
+            auto l = p - b, r = e - (p + 1);
+            if (l < n / 8 || r < n / 8) {
+                if (--bad == 0) return heap_sort(b, e, less);
+                if (l >= insertion_limit) {
+                    std::swap(b[0], b[l / 4]);
+                    std::swap(p[-1], p[-(l / 4)]);
+                    if (l > ninther_limit) {
+                        std::swap(b[1], b[l / 4 + 1]);
+                        std::swap(b[2], b[l / 4 + 2]);
+                        std::swap(p[-2], p[-(l / 4 + 1)]);
+                        std::swap(p[-3], p[-(l / 4 + 2)]);
+                    }
+                }
+                if (r >= insertion_limit) {
+                    std::swap(p[1], p[1 + r / 4]);
+                    std::swap(e[-1], e[-(r / 4)]);
+                    if (r > ninther_limit) {
+                        std::swap(p[2], p[2 + r / 4]);
+                        std::swap(p[3], p[3 + r / 4]);
+                        std::swap(e[-2], e[-(1 + r / 4)]);
+                        std::swap(e[-3], e[-(2 + r / 4)]);
+                    }
+                }
+            } else if (already && partial_insertion(b, p, less) && partial_insertion(p + 1, e, less)) {
+                return;
+            }
+            if (l < r) {
+                pdq(b, p, less, bad, leftmost);
+                b = p + 1, leftmost = false;
+            } else {
+                pdq(p + 1, e, less, bad, false);
+                e = p;
+            }
+        }
+    }
+
+    // merges the halves of each range in place, moving the left one out to buf first;
+    template<typename T>
+    void merge_sort(T* b, T* e, T* buf, auto& less) {
+        if (e - b <= static_cast<ptrdiff_t>(run)) return insertion(b, e, less);
+        auto m = b + (e - b) / 2;
+        merge_sort(b, m, buf, less);
+        merge_sort(m, e, buf, less);
+        if (!less(*m, m[-1])) return;
+        auto be = std::uninitialized_move(b, m, buf);
+        auto i = buf, j = m, o = b;
+        while (i < be && j < e) *o++ = less(*j, *i) ? std::move(*j++) : std::move(*i++);
+        std::move(i, be, o);
+        std::destroy(buf, be);
+    }
+}
+
+template<typename T, typename F>
+requires std::predicate<F&, T&, T&>
+void sort(slice<T> s, F less) {
+    if (s.size() > 1) sorting::pdq(s.begin(), s.end(), less, std::bit_width(s.size()), true);
+}
+
 template<comparable T>
 void sort(slice<T> s) {
-    if (s.size() == 0) return;
-    auto p = &s.front(), q = &s.back();
-    auto&& key = s[s.size() / 2];
-    while (p <= q) {
-        while (*p < key) p++;
-        while (*q > key) q--;
-        if (p <= q) {
-            std::swap(*p, *q);
-            p++, q--;
+    sort(s, std::less<>());
+}
+
+// runs fn(0) ... fn(n - 1) on threads of their own, the first one on this thread;
+inline void parallel(size_t n, auto&& fn) {
+    vector<std::thread> pool;
+    pool.reserve(n);
+    for (size_t i = 1; i < n; i++) pool.emplace_back(fn, i);
+    fn(0);
+    for (auto& t : pool) t.join();
+}
+
+// sample sort: splitters drawn from a sorted sample cut s into buckets, which threads
+// fill from their share of s and then sort on their own, each with sort;
+// elements equal to a splitter get a bucket of their own that needs no sorting,
+// so duplicate keys do not pile up in one bucket; below a few thousand elements per thread
+// it is plain sort, and it needs a buffer as large as s;
+template<typename T, typename F>
+requires std::predicate<F&, T&, T&>
+void parallel_sort(slice<T> s, F less, size_t threads = std::thread::hardware_concurrency()) {
+    constexpr size_t least = 1 << 14, oversample = 64, ratio = 4;
+    auto n = s.size();
+    threads = std::min({ threads, n / least, (size_t)1024 });
+    if (threads <= 1) return sort(s, less);
+
+    // splitters are taken from a sample drawn at pseudo-random positions of every stride;
+    auto count = threads * ratio, stride = n / (count * oversample);
+    vector<T> sample;
+    sample.reserve(count * oversample);
+    for (size_t i = 0, r = 0x9E3779B97F4A7C15; i < count * oversample; i++) {
+        r ^= r << 13, r ^= r >> 7, r ^= r << 17;
+        sample.push_back(s[i * stride + r % stride]);
+    }
+    sort(slice<T>(sample), less);
+    vector<T> splitters;
+    for (size_t i = 1; i < count; i++) {
+        if (splitters.size() == 0 || less(splitters.back(), sample[i * oversample])) {
+            splitters.push_back(sample[i * oversample]);
         }
     }
-    if (q > &s.front()) sort(slice<T>(s.begin(), q+1));
-    if (p < &s.back()) sort(slice<T>(p, s.end()));
+    auto buckets = 2 * splitters.size() + 1;
+
+    // bucket 2j holds what lies strictly between splitters j-1 and j, and bucket 2j+1 equals splitter j;
+    auto classify = [&](T& x) -> uint32_t {
+        size_t lo = 0, hi = splitters.size();
+        while (lo < hi) {
+            auto mid = (lo + hi) / 2;
+            if (less(x, splitters[mid])) hi = mid;
+            else lo = mid + 1;
+        }
+        return lo > 0 && !less(splitters[lo - 1], x) ? 2 * lo - 1 : 2 * lo;
+    };
+
+    auto ids = unique_array<uint32_t>(n, uninit);
+    auto counts = unique_array<size_t>(threads * buckets);
+    auto part = [&](size_t t) { return std::pair(n * t / threads, n * (t + 1) / threads); };
+    parallel(threads, [&](size_t t) {
+        auto [b, e] = part(t);
+        for (auto i = b; i < e; i++) counts[t * buckets + (ids[i] = classify(s[i]))]++;
+    });
+
+    // turns counts into where each thread writes each bucket, and keeps where buckets start;
+    auto starts = unique_array<size_t>(buckets + 1);
+    for (size_t k = 0, at = 0; k < buckets; k++) {
+        starts[k] = at;
+        for (size_t t = 0; t < threads; t++) {
+            auto c = counts[t * buckets + k];
+            counts[t * buckets + k] = at;
+            at += c;
+        }
+    }
+    starts[buckets] = n;
+
+    auto buf = std::allocator<T>().allocate(n);
+    parallel(threads, [&](size_t t) {
+        auto [b, e] = part(t);
+        for (auto i = b; i < e; i++) std::construct_at(buf + counts[t * buckets + ids[i]]++, std::move(s[i]));
+    });
+
+    // threads take the next bucket left until none is;
+    std::atomic<size_t> next = 0;
+    parallel(threads, [&](size_t) {
+        for (size_t k; (k = next.fetch_add(1)) < buckets;) {
+            auto b = buf + starts[k], e = buf + starts[k + 1];
+            if (k % 2 == 0) sort(slice<T>(b, e), less);
+            std::move(b, e, s.begin() + starts[k]);
+            std::destroy(b, e);
+        }
+    });
+    std::allocator<T>().deallocate(buf, n);
+}
+
+template<comparable T>
+void parallel_sort(slice<T> s, size_t threads = std::thread::hardware_concurrency()) {
+    parallel_sort(s, std::less<>(), threads);
+}
+
+// keeps equal elements in their order, using a buffer of half the size of s;
+template<typename T, typename F>
+requires std::predicate<F&, T&, T&>
+void stable_sort(slice<T> s, F less) {
+    if (s.size() <= sorting::run) return sorting::insertion(s.begin(), s.end(), less);
+    auto buf = std::allocator<T>().allocate(s.size() / 2);
+    sorting::merge_sort(s.begin(), s.end(), buf, less);
+    std::allocator<T>().deallocate(buf, s.size() / 2);
+}
+
+template<comparable T>
+void stable_sort(slice<T> s) {
+    stable_sort(s, std::less<>());
+}
+
+// puts the k least elements of s, sorted, at its front, and the rest after them in no order;
+template<typename T, typename F>
+requires std::predicate<F&, T&, T&>
+void partial_sort(slice<T> s, size_t k, F less) {
+    k = std::min(k, s.size());
+    if (k == 0) return;
+    auto b = s.begin();
+    sorting::make_heap(b, k, less);
+    for (auto i = b + k; i < s.end(); i++) {
+        if (!less(*i, *b)) continue;
+        std::swap(*i, *b);
+        sorting::sift_down(b, k, 0, less);
+    }
+    for (size_t i = k; i-- > 1;) {
+        std::swap(b[0], b[i]);
+        sorting::sift_down(b, i, 0, less);
+    }
 }
 
+template<comparable T>
+void partial_sort(slice<T> s, size_t k) {
+    partial_sort(s, k, std::less<>());
+}
+
+// puts at s[n] the element that sorting would put there, with none greater before it
+// and none less after it; unbalanced partitions make it fall back to partial_sort;
+template<typename T, typename F>
+requires std::predicate<F&, T&, T&>
+void nth_element(slice<T> s, size_t n, F less) {
+    if (n >= s.size()) return;
+    auto b = s.begin(), e = s.end(), nth = b + n;
+    for (int bad = 2 * std::bit_width(s.size()); e - b > sorting::insertion_limit; bad--) {
+        if (bad == 0) return partial_sort(slice<T>(b, e), nth - b + 1, less);
+        sorting::choose_pivot(b, e, less);
+        auto p = sorting::partition_right(b, e, less).first;
+        if (p == nth) return;
+        if (nth < p) e = p;
+        else b = p + 1;
+    }
+    sorting::insertion(b, e, less);
+}
+
+template<comparable T>
+void nth_element(slice<T> s, size_t n) {
+    nth_element(s, n, std::less<>());
+}
+
+// returns the first element of [b, b + n) for which below is false, where below is true of a prefix of it and false after;
+// each step halves the range by adding to b, since compilers keep a branch for a select of pointers,
+// and prefetches both elements the next step may probe, which hides the cache misses of large slices;
 template<typename T>
-void sort(slice<T> s, std::function<bool(T&,T&)> less) {
-    if (s.size() == 0) return;
-    auto p = &s.front(), q = &s.back();
-    auto&& key = s[s.size() / 2];
-    while (p <= q) {
-        while (less(*p, key)) p++;
-        while (less(key, *q)) q--;
-        if (p <= q) {
-            std::swap(*p, *q);
-            p++, q--;
+T* bisect(T* b, size_t n, auto&& below) {
+    if (n == 0) return b;
+    while (n > 1) {
+        auto half = n / 2;
+        prefetch(b + half / 2);
+        prefetch(b + half + half / 2);
+        bool right = below(b[half - 1]);
+        b += right * half;
+        n -= half;
+    }
+    return below(*b) ? b + 1 : b;
+}
+
+// the first element of sorted s that is not less than value, or s.end();
+template<typename T, typename V, typename F>
+requires std::predicate<F&, T&, const V&>
+T* lower_bound(slice<T> s, const V& value, F less) {
+    return bisect(s.begin(), s.size(), [&](T& x) { return less(x, value); });
+}
+
+template<comparable T>
+T* lower_bound(slice<T> s, const std::type_identity_t<T>& value) {
+    return lower_bound(s, value, std::less<>());
+}
+
+// the first element of sorted s that is greater than value, or s.end();
+template<typename T, typename V, typename F>
+requires std::predicate<F&, const V&, T&>
+T* upper_bound(slice<T> s, const V& value, F less) {
+    return bisect(s.begin(), s.size(), [&](T& x) { return !less(value, x); });
+}
+
+template<comparable T>
+T* upper_bound(slice<T> s, const std::type_identity_t<T>& value) {
+    return upper_bound(s, value, std::less<>());
+}
+
+// the elements of sorted s that are equal to value;
+template<typename T, typename V, typename F>
+requires std::predicate<F&, T&, const V&> && std::predicate<F&, const V&, T&>
+slice<T> equal_range(slice<T> s, const V& value, F less) {
+    auto b = lower_bound(s, value, less);
+    return slice<T>(b, upper_bound(slice<T>(b, s.end()), value, less));
+}
+
+template<comparable T>
+slice<T> equal_range(slice<T> s, const std::type_identity_t<T>& value) {
+    return equal_range(s, value, std::less<>());
+}
+
+template<typename T, typename V, typename F>
+requires std::predicate<F&, T&, const V&> && std::predicate<F&, const V&, T&>
+bool binary_search(slice<T> s, const V& value, F less) {
+    auto p = lower_bound(s, value, less);
+    return p != s.end() && !less(value, *p);
+}
+
+template<comparable T>
+bool binary_search(slice<T> s, const std::type_identity_t<T>& value) {
+    return binary_search(s, value, std::less<>());
+}
+
+// the first element equal to value, or nullptr;
+template<equality_comparable T>
+T* find(slice<T> s, const std::type_identity_t<T>& value) {
+    if constexpr (arithmetic<T>) {
+        using U = std::remove_cv_t<T>;
+        auto i = kernels::dispatch<kernels::find>(static_cast<const U*>(s.begin()), s.size(), U(value), true);
+        return i == s.size() ? nullptr : s.begin() + i;
+    } else {
+        for (auto& x : s) if (x == value) return &x;
+        return nullptr;
+    }
+}
+
+template<equality_comparable T>
+bool contains(slice<T> s, const std::type_identity_t<T>& value) {
+    return find(s, value) != nullptr;
+}
+
+template<equality_comparable T>
+size_t count(slice<T> s, const std::type_identity_t<T>& value) {
+    if constexpr (arithmetic<T>) {
+        using U = std::remove_cv_t<T>;
+        return kernels::dispatch<kernels::count>(static_cast<const U*>(s.begin()), s.size(), U(value));
+    } else {
+        size_t c = 0;
+        for (auto& x : s) c += x == value;
+        return c;
+    }
+}
+
+// the least and the greatest element; NaNs are passed over, unless the first element is one;
+template<comparable T>
+std::pair<T, T> min_max(slice<T> s) {
+    if (s.size() == 0) throw std::out_of_range("min_max: empty slice");
+    if constexpr (arithmetic<T>) {
+        using U = std::remove_cv_t<T>;
+        return kernels::dispatch<kernels::min_max>(static_cast<const U*>(s.begin()), s.size());
+    } else {
+        auto lo = s.begin(), hi = s.begin();
+        for (auto p = s.begin() + 1; p != s.end(); p++) {
+            if (*p < *lo) lo = p;
+            if (*hi < *p) hi = p;
         }
+        return { *lo, *hi };
+    }
+}
+
+// integers are summed in 64 bits, wrapping around on overflow,
+// and floats in a different order than a loop would;
+template<arithmetic T>
+auto sum(slice<T> s) {
+    using U = std::remove_cv_t<T>;
+    return kernels::dispatch<kernels::sum>(static_cast<const U*>(s.begin()), s.size());
+}
+
+template<arithmetic T>
+auto dot(slice<T> a, slice<T> b) {
+    if (a.size() != b.size()) {
+        throw std::invalid_argument("dot: sizes differ (" + std::to_string(a.size()) + " and " + std::to_string(b.size()) + ")");
     }
-    if (q > &s.front()) sort(slice<T>(s.begin(), q+1), less);
-    if (p < &s.back()) sort(slice<T>(p, s.end()), less);
+    using U = std::remove_cv_t<T>;
+    return kernels::dispatch<kernels::dot>(static_cast<const U*>(a.begin()), static_cast<const U*>(b.begin()), a.size());
+}
+
+// whether every element is non-zero;
+template<arithmetic T>
+bool all(slice<T> s) {
+    using U = std::remove_cv_t<T>;
+    return kernels::dispatch<kernels::find>(static_cast<const U*>(s.begin()), s.size(), U(0), true) == s.size();
 }
 
-}
\ No newline at end of file
+// whether any element is non-zero;
+template<arithmetic T>
+bool any(slice<T> s) {
+    using U = std::remove_cv_t<T>;
+    return kernels::dispatch<kernels::find>(static_cast<const U*>(s.begin()), s.size(), U(0), false) != s.size();
+}
+
+}
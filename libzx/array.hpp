@@ -33,16 +33,11 @@ public:
     }
 
     auto operator<=>(const array& a) const {
-        for (size_t i = 0; i < N-1; i++) {
-            if (data[i] != a.data[i]) {
-                return data[i] <=> a.data[i];
-            }
-        }
-        return data[N-1] <=> a.data[N-1];
+        return elements::compare<T>(data, a.data, N);
     }
 
     auto operator==(const array& a) const {
-        return (*this <=> a) == 0;
+        return elements::equal<T>(data, a.data, N);
     }
 
     T& at(size_t i) {
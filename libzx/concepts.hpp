@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <concepts>
 #include <type_traits>
 
 namespace libzx {
@@ -41,4 +43,20 @@ concept joinable_to = requires(T t, J j) { j += t; };
 template<typename T>
 concept integral = std::is_integral_v<T> || std::is_pointer_v<T>;
 
+// numbers that fit in a SIMD lane: not bool, and not long double;
+template<typename T>
+concept arithmetic = std::is_arithmetic_v<T> && !std::is_same_v<std::remove_cv_t<T>, bool> && sizeof(T) <= 8;
+
+// types that are equal exactly when their bytes are, so that memcmp can compare them;
+template<typename T>
+concept bitwise_comparable = std::is_integral_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>;
+
+// moving a trivially relocatable object to another address and ending its lifetime at the old one
+// is the same as copying its bytes; libzx containers are, and user types opt in by specializing it;
+template<typename T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+template<typename T>
+concept trivially_relocatable = is_trivially_relocatable<T>::value;
+
 }
\ No newline at end of file
@@ -0,0 +1,162 @@
+#pragma once
+#include <bit>
+#include <mutex>
+#include <atomic>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include "hashmap.hpp"
+
+namespace libzx {
+
+// reader_lock is a readers-writer lock whose readers count themselves on cache lines of their own,
+// picked by thread, so that readers of a shared lock never write to a line that other readers use;
+// a writer raises its flag, which readers only read, and waits until every count drains to zero;
+// it meets the requirements of std::shared_lock and std::unique_lock;
+class reader_lock {
+protected:
+    struct alignas(64) count { std::atomic<uint32_t> n{0}; };
+
+    unique_array<count> counts;
+    alignas(64) std::atomic<bool> writing{false};
+    std::mutex writers;
+
+    // threads take slots in turn, and share one only when there are more threads than slots;
+    auto& mine() {
+        static std::atomic<size_t> next{0};
+        thread_local size_t slot = next.fetch_add(1, std::memory_order_relaxed);
+        return counts[slot & (counts.size() - 1)].n;
+    }
+public:
+    reader_lock(size_t slots = std::thread::hardware_concurrency()) :
+        counts(std::bit_ceil(std::clamp(slots, (size_t)1, (size_t)64))) {}
+
+    // counting first and then checking the flag, while a writer does the opposite, makes sure
+    // that at least one of them sees the other, as long as all four accesses are seq_cst;
+    void lock_shared() {
+        auto& n = mine();
+        while (true) {
+            n.fetch_add(1, std::memory_order_seq_cst);
+            if (!writing.load(std::memory_order_seq_cst)) return;
+            n.fetch_sub(1, std::memory_order_release);
+            while (writing.load(std::memory_order_relaxed)) std::this_thread::yield();
+        }
+    }
+
+    void unlock_shared() { mine().fetch_sub(1, std::memory_order_release); }
+
+    void lock() {
+        writers.lock();
+        writing.store(true, std::memory_order_seq_cst);
+        for (auto& c : counts) {
+            while (c.n.load(std::memory_order_seq_cst) != 0) std::this_thread::yield();
+        }
+    }
+
+    void unlock() {
+        writing.store(false, std::memory_order_release);
+        writers.unlock();
+    }
+};
+
+// concurrent_hashmap splits keys over independently locked hashmaps by the top bits of their hash;
+// readers of a shard share its reader_lock, so that lookups of the same shard write to no common
+// cache line, and a shard grows while the others stay available;
+// values are handed out by copy or through callbacks run under the lock, never by reference;
+template<hashable K, typename V>
+class concurrent_hashmap {
+protected:
+    struct alignas(64) shard : hashmap<K, V> {
+        using base = hashmap<K, V>;
+        using pair = typename base::pair;
+        mutable reader_lock lock;
+
+        auto find(const auto& key, size_t h) { return base::find(key, h); }
+        void insert(auto&& key, auto&& value, size_t h) {
+            base::insert(std::forward<decltype(key)>(key), std::forward<decltype(value)>(value), h);
+        }
+        auto emplace(auto&& key, size_t h) { return base::emplace(std::forward<decltype(key)>(key), h); }
+        void erase(typename base::pair* t) { base::erase(t); }
+
+        // reads every slot without moving any, unlike begin(), which finishes a pending resize;
+        void visit(auto&& fn) {
+            for (size_t i = 0; i < base::data.size(); i++) {
+                if (ctrl::is_full(base::state[i])) fn(static_cast<const pair&>(base::data[i]));
+            }
+            for (size_t i = 0; i < base::old_data.size(); i++) {
+                if (ctrl::is_full(base::old_state[i])) fn(static_cast<const pair&>(base::old_data[i]));
+            }
+        }
+    };
+
+    unique_array<shard> shards;
+    size_t shift;
+
+    auto& pick(size_t h) { return shards[h >> shift]; }
+public:
+    concurrent_hashmap(size_t n = std::thread::hardware_concurrency() * 4) :
+        shards(std::bit_ceil(std::max(n, (size_t)2))),
+        shift(64 - std::countr_zero(shards.size())) {}
+
+    auto& set(convertible_to<K> auto&& key, convertible_to<V> auto&& value) {
+        auto h = hash(key);
+        auto& s = pick(h);
+        std::unique_lock l(s.lock);
+        s.insert(std::forward<decltype(key)>(key), std::forward<decltype(value)>(value), h);
+        return *this;
+    }
+
+    // calls fn on the value of key under the lock of its shard, default constructing it if missing;
+    void upsert(convertible_to<K> auto&& key, std::invocable<V&> auto&& fn) {
+        auto h = hash(key);
+        auto& s = pick(h);
+        std::unique_lock l(s.lock);
+        fn(s.emplace(std::forward<decltype(key)>(key), h).first);
+    }
+
+    auto get(const K& key) -> std::optional<V> {
+        auto h = hash(key);
+        auto& s = pick(h);
+        std::shared_lock l(s.lock);
+        if (auto t = s.find(key, h); t != nullptr) return t->value;
+        return std::nullopt;
+    }
+
+    bool contains(const K& key) {
+        auto h = hash(key);
+        auto& s = pick(h);
+        std::shared_lock l(s.lock);
+        return s.find(key, h) != nullptr;
+    }
+
+    bool remove(const K& key) {
+        auto h = hash(key);
+        auto& s = pick(h);
+        std::unique_lock l(s.lock);
+        if (auto t = s.find(key, h); t != nullptr) {
+            s.erase(t);
+            return true;
+        }
+        return false;
+    }
+
+    // visits every pair, holding one shard at a time;
+    void for_each(std::invocable<const typename hashmap<K, V>::pair&> auto&& fn) {
+        for (auto&& s : shards) {
+            std::shared_lock l(s.lock);
+            s.visit(fn);
+        }
+    }
+
+    // a snapshot, since other threads may change the shards while they are counted;
+    size_t size() {
+        size_t n = 0;
+        for (auto&& s : shards) {
+            std::shared_lock l(s.lock);
+            n += s.size();
+        }
+        return n;
+    }
+};
+
+}
\ No newline at end of file
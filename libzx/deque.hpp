@@ -14,9 +14,9 @@ protected:
     void grow(size_t size = 2) {
         auto new_cap = std::bit_ceil(data.size() + size);
         auto new_data = unique_array<T>(new_cap);
-        std::move(data.begin(), data.begin() + last, new_data.begin());
+        relocate_over(data.begin(), last, new_data.begin());
         if (first > last) {
-            std::move(data.begin() + first, data.end(), new_data.end() - data.size() + first);
+            relocate_over(data.begin() + first, data.size() - first, new_data.end() - data.size() + first);
             first = new_data.size() - data.size() + first;
         }
         data = std::move(new_data);
@@ -122,4 +122,7 @@ public:
     auto end() { return iter{ this, &data[last] }; }   
 };
 
+template<typename T>
+struct is_trivially_relocatable<deque<T>> : std::true_type {};
+
 }
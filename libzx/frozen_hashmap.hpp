@@ -0,0 +1,234 @@
+#pragma once
+#include <bit>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include "hash.hpp"
+#include "probe.hpp"
+#include "concepts.hpp"
+#include "smart_array.hpp"
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define LIBZX_MMAP 1
+#endif
+
+namespace libzx {
+
+// frozen_hashmap is a read-only table laid out in one flat image, which is written once
+// and then mapped by every process reading it, with nothing rebuilt or deserialized;
+// keys and values are stored as they are, except string keys, which are stored as
+// offsets into a block of characters at the end of the image;
+// the image keeps the hashes it was built with, so hash(K) must not vary between processes;
+// it records the sizes and alignments of K and V, and the group width it was probed with,
+// and is refused where they differ; types alike in both cannot be told apart;
+template<typename K, typename V>
+requires ((std::is_trivially_copyable_v<K> && !std::is_pointer_v<K>) || std::same_as<K, string>) &&
+    std::is_trivially_copyable_v<V>
+class frozen_hashmap {
+protected:
+    static constexpr bool inline_key = !std::same_as<K, string>;
+    static constexpr char magic[8] = "libzxf2";
+
+    struct text { uint64_t offset, size; };
+    struct slot { std::conditional_t<inline_key, K, text> key; V value; };
+    struct header {
+        char magic[8];
+        uint64_t slot_size, key_size, key_align, value_size, value_align, width;
+        uint64_t cap, len, slots, chars;
+    };
+
+    const char* image = nullptr;
+    size_t image_size = 0;
+    unique_array<char> owned;
+    const header* head = nullptr;
+
+    size_t cap() const { return head->cap; }
+    auto state() const { return reinterpret_cast<const int8_t*>(image + sizeof(header)); }
+    auto slots() const { return reinterpret_cast<const slot*>(image + head->slots); }
+    auto chars() const { return slice<const char>(image + head->chars, image + image_size); }
+
+    static auto view(const char* s) { return slice<const char>(s, s + strlen(s)); }
+    static auto view(const auto& s) { return slice<const char>(s.begin(), s.end()); }
+
+    // inline keys are converted to K, so that they hash and compare as the stored ones do,
+    // and string keys are used as they are, since only their chars are hashed;
+    static decltype(auto) as_key(const auto& key) {
+        if constexpr (inline_key) return static_cast<K>(key);
+        else return (key);
+    }
+
+    static size_t hash_of(const auto& key) {
+        if constexpr (inline_key) return hash(key);
+        else {
+            auto s = view(key);
+            return hash(s.begin(), s.size());
+        }
+    }
+
+    static bool same(const slot& s, slice<const char> chars, const auto& key) {
+        if constexpr (inline_key) return s.key == key;
+        else {
+            auto k = view(key);
+            if (s.key.size != k.size()) return false;
+            if (s.key.offset > chars.size() || s.key.size > chars.size() - s.key.offset)
+                throw std::runtime_error("frozen_hashmap: image is corrupt, a key lies past its end");
+            return memcmp(chars.begin() + s.key.offset, k.begin(), k.size()) == 0;
+        }
+    }
+
+    // finds key, or else the first free slot on its probe sequence, reported as not found;
+    static auto find(const int8_t* state, const slot* slots, slice<const char> chars, size_t cap,
+                     const auto& key, size_t h) -> std::pair<size_t, bool> {
+        size_t mask = cap - 1, free = cap;
+        for (size_t i = ctrl::h1(h) & mask, j = 0; j < cap; i = (i + group::width) & mask, j += group::width) {
+            auto g = group(&state[i]);
+            for (auto k : g.match(ctrl::h2(h))) {
+                if (same(slots[(i + k) & mask], chars, key)) return { (i + k) & mask, true };
+            }
+            if (auto m = g.match_free(); m && free == cap) free = (i + m.trailing_zeros()) & mask;
+            if (g.match_empty()) break;
+        }
+        return { free, false };
+    }
+
+    auto find(const auto& key) const -> const slot* {
+        auto [i, found] = find(state(), slots(), chars(), cap(), key, hash_of(key));
+        return found ? &slots()[i] : nullptr;
+    }
+
+    void unmap() {
+#ifdef LIBZX_MMAP
+        if (image != nullptr) munmap(const_cast<char*>(image), image_size);
+        image = nullptr;
+#endif
+    }
+
+    void check() {
+        if (image_size < sizeof(header))
+            throw std::runtime_error("frozen_hashmap: image is truncated");
+        head = reinterpret_cast<const header*>(image);
+        if (memcmp(head->magic, magic, sizeof(magic)) != 0 || head->slot_size != sizeof(slot) ||
+            head->key_size != sizeof(K) || head->key_align != alignof(K) ||
+            head->value_size != sizeof(V) || head->value_align != alignof(V))
+            throw std::runtime_error("frozen_hashmap: image was not written for this table type");
+        if (head->width != group::width)
+            throw std::runtime_error("frozen_hashmap: image was written for groups of " +
+                std::to_string(head->width) + " slots, not " + std::to_string(group::width));
+        if (!std::has_single_bit(head->cap) || head->cap < group::width || head->cap > image_size || head->len > head->cap)
+            throw std::runtime_error("frozen_hashmap: image is corrupt");
+        if (head->slots < sizeof(header) + head->cap + group::width ||
+            head->chars != head->slots + head->cap * sizeof(slot) || head->chars > image_size)
+            throw std::runtime_error("frozen_hashmap: image is truncated");
+    }
+public:
+    // maps the image at path, or reads it where mmap is not available;
+    frozen_hashmap(const char* path) {
+#ifdef LIBZX_MMAP
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) throw std::runtime_error("frozen_hashmap: cannot open " + std::string(path));
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            throw std::runtime_error("frozen_hashmap: cannot map " + std::string(path));
+        }
+        auto p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) throw std::runtime_error("frozen_hashmap: cannot map " + std::string(path));
+        image = static_cast<const char*>(p);
+        image_size = st.st_size;
+#else
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in) throw std::runtime_error("frozen_hashmap: cannot open " + std::string(path));
+        owned = unique_array<char>(static_cast<size_t>(in.tellg()), uninit);
+        in.seekg(0).read(owned.begin(), owned.size());
+        image = owned.begin();
+        image_size = owned.size();
+#endif
+        try {
+            check();
+        } catch (...) {
+            unmap();
+            throw;
+        }
+    }
+
+    frozen_hashmap(const frozen_hashmap&) = delete;
+    auto& operator=(const frozen_hashmap&) = delete;
+
+    ~frozen_hashmap() { unmap(); }
+
+    // writes the image of pairs, any sized range of elements with a key and a value,
+    // such as a hashmap; a repeated key keeps its last value;
+    static void write(const char* path, streamable auto&& pairs) {
+        size_t n = pairs.size(), total = 0;
+        if constexpr (!inline_key) for (auto&& [k, v] : pairs) total += view(k).size();
+
+        header h{};
+        memcpy(h.magic, magic, sizeof(magic));
+        h.slot_size = sizeof(slot);
+        h.key_size = sizeof(K), h.key_align = alignof(K);
+        h.value_size = sizeof(V), h.value_align = alignof(V);
+        h.width = group::width;
+        h.cap = std::bit_ceil(std::max((size_t)(n / 0.8) + 1, group::width));
+        h.slots = (sizeof(header) + h.cap + group::width + 63) / 64 * 64;
+        h.chars = h.slots + h.cap * sizeof(slot);
+
+        auto image = unique_array<char>(h.chars + total);
+        auto state = reinterpret_cast<int8_t*>(image.begin() + sizeof(header));
+        auto slots = reinterpret_cast<slot*>(image.begin() + h.slots);
+        auto chars = image.begin() + h.chars;
+        std::fill(state, state + h.cap + group::width, ctrl::empty);
+
+        size_t used = 0;
+        for (auto&& [key, v] : pairs) {
+            decltype(auto) k = as_key(key);
+            auto hv = hash_of(k);
+            auto [i, found] = find(state, slots, slice<const char>(chars, chars + total), h.cap, k, hv);
+            if (!found) {
+                if constexpr (inline_key) slots[i].key = k;
+                else {
+                    auto s = view(k);
+                    memcpy(chars + used, s.begin(), s.size());
+                    slots[i].key = text{ used, s.size() };
+                    used += s.size();
+                }
+                state[i] = ctrl::h2(hv);
+                if (i < group::width) state[h.cap + i] = ctrl::h2(hv);
+                h.len++;
+            }
+            slots[i].value = v;
+        }
+        memcpy(image.begin(), &h, sizeof(h));
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(image.begin(), h.chars + used);
+        if (!out) throw std::runtime_error("frozen_hashmap: cannot write " + std::string(path));
+    }
+
+    auto get(const K& key) const -> std::optional<std::reference_wrapper<const V>> {
+        if (auto t = find(key); t != nullptr) return t->value;
+        return std::nullopt;
+    }
+
+    // looks up string keys from a slice<char> or a C string, without building a string;
+    auto get(const auto& key) const -> std::optional<std::reference_wrapper<const V>> requires (!inline_key) {
+        if (auto t = find(key); t != nullptr) return t->value;
+        return std::nullopt;
+    }
+
+    bool contains(const K& key) const {
+        return find(key) != nullptr;
+    }
+
+    bool contains(const auto& key) const requires (!inline_key) {
+        return find(key) != nullptr;
+    }
+
+    size_t size() const noexcept { return head->len; }
+};
+
+}
\ No newline at end of file
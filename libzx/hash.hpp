@@ -4,18 +4,92 @@
 
 namespace libzx {
 
+// mix spreads every input bit over the whole word (splitmix64 finalizer);
+// tables take slots from the low bits with a mask, so weak hashes should end with it;
+inline constexpr size_t mix(size_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EB;
+    x ^= x >> 31;
+    return x;
+}
+
+// 64x64 -> 128 bit multiplication, leaving the low half in a and the high half in b;
+inline void mul128(uint64_t& a, uint64_t& b) {
+#ifdef __SIZEOF_INT128__
+    auto r = static_cast<unsigned __int128>(a) * b;
+    a = static_cast<uint64_t>(r), b = static_cast<uint64_t>(r >> 64);
+#else
+    uint64_t ha = a >> 32, la = static_cast<uint32_t>(a), hb = b >> 32, lb = static_cast<uint32_t>(b);
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+    uint64_t lo = t + (rm1 << 32), hi = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+    a = lo, b = hi;
+#endif
+}
+
+inline uint64_t fold_mul(uint64_t a, uint64_t b) {
+    mul128(a, b);
+    return a ^ b;
+}
+
+// hashes `len` bytes a word at a time (wyhash), embedded zeros included;
+inline size_t hash(const char* s, size_t len) {
+    constexpr uint64_t secret[] = { 0x2D358DCCAA6C78A5, 0x8BB84B93962EACC9, 0x4B33A62ED433D4A3, 0x4D5A2DA51DE1AA47 };
+    auto r8 = [](const char* p) { uint64_t v; std::memcpy(&v, p, 8); return v; };
+    auto r4 = [](const char* p) { uint32_t v; std::memcpy(&v, p, 4); return static_cast<uint64_t>(v); };
+    auto p = s;
+    uint64_t seed = fold_mul(secret[0], secret[1]), a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            auto k = (len >> 3) << 2;
+            a = (r4(p) << 32) | r4(p + k);
+            b = (r4(p + len - 4) << 32) | r4(p + len - 4 - k);
+        } else if (len > 0) {
+            a = (static_cast<uint64_t>(static_cast<uint8_t>(p[0])) << 16) |
+                (static_cast<uint64_t>(static_cast<uint8_t>(p[len >> 1])) << 8) |
+                static_cast<uint8_t>(p[len - 1]);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        auto i = len;
+        if (i > 48) {
+            auto see1 = seed, see2 = seed;
+            do {
+                seed = fold_mul(r8(p) ^ secret[1], r8(p + 8) ^ seed);
+                see1 = fold_mul(r8(p + 16) ^ secret[2], r8(p + 24) ^ see1);
+                see2 = fold_mul(r8(p + 32) ^ secret[3], r8(p + 40) ^ see2);
+                p += 48, i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        for (; i > 16; p += 16, i -= 16) {
+            seed = fold_mul(r8(p) ^ secret[1], r8(p + 8) ^ seed);
+        }
+        a = r8(p + i - 16);
+        b = r8(p + i - 8);
+    }
+    a ^= secret[1], b ^= seed;
+    mul128(a, b);
+    return fold_mul(a ^ secret[0] ^ len, b ^ secret[1]);
+}
+
 inline size_t hash(const char* s) {
-    size_t seed = 131, hash = 0;
-    while (*s) hash = hash * seed + (*s++);
-    return hash;
+    return hash(s, strlen(s));
 }
 
 inline size_t hash(const string& s) {
-    return hash(s.c_str());
+    return hash(s.begin(), s.size());
+}
+
+inline size_t hash(const slice<char>& s) {
+    return hash(s.begin(), s.size());
 }
 
 inline size_t hash(integral auto i) {
-    return (static_cast<size_t>(i) * 2654435761) ^ 0xAAAAAAAAAAAAAAAA;
+    return mix(static_cast<size_t>(i));
 }
 
 inline size_t hash(float i) {
@@ -29,4 +103,9 @@ inline size_t hash(double i) {
 template<typename T>
 concept hashable = requires(T t) { { hash(t) } -> convertible_to<size_t>; t == t; };
 
-}
+// T can be looked up in tables keyed by K directly, hashing equal to the K it compares equal to;
+template<typename T, typename K>
+concept hashable_as = std::same_as<K, string> &&
+    (convertible_to<T, const char*> || std::same_as<std::remove_cvref_t<T>, slice<char>>);
+
+}
\ No newline at end of file
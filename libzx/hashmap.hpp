@@ -1,108 +1,371 @@
 #pragma once
 #include <optional>
+#include <algorithm>
 #include <initializer_list>
 #include "hash.hpp"
+#include "probe.hpp"
 #include "range.hpp"
 #include "concepts.hpp"
 #include "smart_array.hpp"
 
 namespace libzx {
 
-template<hashable K, typename V>
+// with cache set, the full hash of every element is kept in a parallel array,
+// so that resizing never hashes a key again and probing compares hashes before keys;
+// it is on by default for keys that are expensive to hash or compare, such as strings;
+template<hashable K, typename V, bool cache = !std::is_trivially_copyable_v<K>>
 class hashmap {
 public:
     struct pair { K key; V value; };
 protected:
-    struct status { uint8_t occupied : 1, conflict : 1; };
+    // pairs of relocatable keys and values are moved between slots by their bytes;
+    static constexpr bool relocatable = trivially_relocatable<K> && trivially_relocatable<V>;
 
     unique_array<pair> data;
-    unique_array<status> state;
-    size_t len = 0;
+    unique_array<int8_t> state;
+    unique_array<size_t> hashes;
+    size_t len = 0, tomb = 0;
+    // the table being drained into data while resizing incrementally;
+    unique_array<pair> old_data;
+    unique_array<int8_t> old_state;
+    unique_array<size_t> old_hashes;
+    size_t moved = 0;
+    bool gradual = false;
     size_t cap() { return data.size(); }
-    double payload() { return (double)len / (double)data.size(); }
+    size_t mask() { return data.size() - 1; }
+    double payload() { return (double)(len + tomb) / (double)data.size(); }
 
+    static auto make_state(size_t cap) {
+        auto state = unique_array<int8_t>(cap + group::width, uninit);
+        std::fill(state.begin(), state.end(), ctrl::empty);
+        return state;
+    }
+
+    static void mark(unique_array<int8_t>& state, size_t i, int8_t c) {
+        state[i] = c;
+        if (i < group::width) state[state.size() - group::width + i] = c;
+    }
+
+    void mark(size_t i, int8_t c) { mark(state, i, c); }
+
+    static size_t hash_at(unique_array<pair>& data, unique_array<size_t>& hashes, size_t i) {
+        if constexpr (cache) return hashes[i];
+        else return hash(data[i].key);
+    }
+
+    void remember(size_t i, size_t h) {
+        if constexpr (cache) hashes[i] = h;
+    }
+
+    // when deleted slots dominate, they are cleared without reallocating instead;
     void grow() {
-        auto new_cap = data.size() * 2 + 1;
-        auto new_data = unique_array<pair>(new_cap);
-        auto new_state = unique_array<status>(new_cap);
+        finish();
+        if (tomb > len) return rehash();
+        grow(std::max(cap() * 2, group::width), gradual);
+    }
+
+    // moves to a table of new_cap slots, either at once or a few slots per operation;
+    void grow(size_t new_cap, bool gradually) {
+        finish();
+        old_data = std::move(data);
+        old_state = std::move(state);
+        old_hashes = std::move(hashes);
+        // slots are only read once their control byte is full, so they need no zeroing;
+        data = unique_array<pair>(new_cap, uninit);
+        state = make_state(new_cap);
+        if constexpr (cache) hashes = unique_array<size_t>(new_cap, uninit);
+        moved = tomb = 0;
+        if (!gradually) finish();
+    }
+
+    // moves up to n slots of the old table into the current one;
+    // deleted marks keep the probe sequences of the old table intact;
+    void migrate(size_t n) {
+        for (auto end = std::min(moved + n, old_data.size()); moved < end; moved++) {
+            if (!ctrl::is_full(old_state[moved])) continue;
+            auto h = hash_at(old_data, old_hashes, moved);
+            auto i = find_free(h);
+            if (state[i] == ctrl::deleted) tomb--;
+            relocate_over<pair, relocatable>(&old_data[moved], 1, &data[i]);
+            remember(i, h);
+            mark(i, ctrl::h2(h));
+            mark(old_state, moved, ctrl::deleted);
+        }
+        if (moved == old_data.size()) {
+            old_data = unique_array<pair>();
+            old_state = unique_array<int8_t>();
+            old_hashes = unique_array<size_t>();
+        }
+    }
+
+    // every insertion or removal moves a group worth of slots, which drains the old table
+    // long before the current one, twice as large, needs to grow again;
+    // lookups do not, so that they never move what an earlier lookup returned;
+    void step() {
+        if (old_data.size() != 0) migrate(group::width);
+    }
+
+    void finish() {
+        if (old_data.size() != 0) migrate(old_data.size());
+    }
+
+    // moves every element to the first free slot of its probe sequence, in place;
+    void rehash() {
         for (auto i : urange(data)) {
-            if (!state[i].occupied) continue;
-            for (size_t j = hash(data[i].key) % new_cap, k = 0; k < new_cap; j = (j+1) % new_cap, k++) {
-                if (new_state[j].occupied) {
-                    new_state[j].conflict = true;
-                    continue;
+            state[i] = ctrl::is_full(state[i]) ? ctrl::deleted : ctrl::empty;
+        }
+        std::copy(state.begin(), state.begin() + group::width, state.begin() + cap());
+        for (size_t i = 0; i < cap();) {
+            if (state[i] != ctrl::deleted) { i++; continue; }
+            auto h = hash_at(data, hashes, i);
+            auto j = find_free(h);
+            auto start = ctrl::h1(h) & mask();
+            auto probe = [&](size_t k) { return ((k - start) & mask()) / group::width; };
+            if (probe(i) == probe(j)) {
+                mark(i, ctrl::h2(h));
+                i++;
+            } else if (state[j] == ctrl::empty) {
+                relocate_over<pair, relocatable>(&data[i], 1, &data[j]);
+                remember(j, h);
+                mark(j, ctrl::h2(h));
+                mark(i, ctrl::empty);
+                i++;
+            } else {
+                std::swap(data[i], data[j]);
+                if constexpr (cache) std::swap(hashes[i], hashes[j]);
+                mark(j, ctrl::h2(h));
+            }
+        }
+        tomb = 0;
+    }
+
+    void erase(pair* t) {
+        if (t >= data.begin() && t < data.end()) return erase(t - data.begin());
+        mark(old_state, t - old_data.begin(), ctrl::deleted);
+        len--;
+    }
+
+    // a slot may become empty again if no group could have seen it full without an empty slot;
+    void erase(size_t i) {
+        auto after = group(&state[i]).match_empty();
+        auto before = group(&state[(i - group::width) & mask()]).match_empty();
+        if (after && before && after.trailing_zeros() + before.leading_zeros() < group::width) {
+            mark(i, ctrl::empty);
+        } else {
+            mark(i, ctrl::deleted);
+            tomb++;
+        }
+        len--;
+    }
+
+    // probes a group per step, comparing keys only where the stored hash bits match;
+    static auto find(unique_array<pair>& data, unique_array<int8_t>& state, unique_array<size_t>& hashes,
+                     const auto& key, size_t h) -> pair* {
+        auto cap = data.size(), mask = cap - 1;
+        for (size_t i = ctrl::h1(h) & mask, j = 0; j < cap; i = (i + group::width) & mask, j += group::width) {
+            auto g = group(&state[i]);
+            for (auto k : g.match(ctrl::h2(h))) {
+                if constexpr (cache) {
+                    if (hashes[(i + k) & mask] != h) continue;
                 }
-                new_data[j] = pair{
-                    std::move(data[i].key),
-                    std::move(data[i].value)
-                };
-                new_state[j].occupied = true;
-                break;
+                auto& p = data[(i + k) & mask];
+                if (p.key == key) return &p;
             }
+            if (g.match_empty()) break;
         }
-        data = std::move(new_data);
-        state = std::move(new_state);
+        return nullptr;
+    }
+
+    auto find(const auto& key, size_t h) -> pair* {
+        if (auto t = find(data, state, hashes, key, h); t != nullptr || old_data.size() == 0) return t;
+        return find(old_data, old_state, old_hashes, key, h);
     }
 
     auto find(const K& key) -> pair* {
-        for (size_t i = hash(key) % cap(), j = 0; j < cap(); i = (i+1) % cap(), j++) {
-            if (state[i].occupied && data[i].key == key) {
-                return &data[i];
+        return find(key, hash(key));
+    }
+
+    auto find(const hashable_as<K> auto& key) -> pair* {
+        return find(key, hash(key));
+    }
+
+    // there is always a free slot, since the table grows before it fills up;
+    size_t find_free(size_t h) {
+        for (size_t i = ctrl::h1(h) & mask(); ; i = (i + group::width) & mask()) {
+            if (auto m = group(&state[i]).match_free()) return (i + m.trailing_zeros()) & mask();
+        }
+    }
+
+    // finds key and, on the way, the first free slot it could be put in;
+    auto find_slot(const auto& key, size_t h) -> std::pair<size_t, bool> {
+        size_t free = cap();
+        for (size_t i = ctrl::h1(h) & mask(), j = 0; j < cap(); i = (i + group::width) & mask(), j += group::width) {
+            auto g = group(&state[i]);
+            for (auto k : g.match(ctrl::h2(h))) {
+                if constexpr (cache) {
+                    if (hashes[(i + k) & mask()] != h) continue;
+                }
+                if (data[(i + k) & mask()].key == key) return { (i + k) & mask(), true };
             }
-            if (!state[i].conflict) {
-                break;
+            if (auto m = g.match_free(); m && free == cap()) free = (i + m.trailing_zeros()) & mask();
+            if (g.match_empty()) break;
+        }
+        return { free, false };
+    }
+
+    void occupy(size_t i, size_t h) {
+        if (state[i] == ctrl::deleted) tomb--;
+        remember(i, h);
+        mark(i, ctrl::h2(h));
+        len++;
+    }
+
+    void insert(auto&& key, auto&& value, size_t h) {
+        step();
+        if (cap() == 0 || payload() > 0.6) grow();
+        if (auto t = find(old_data, old_state, old_hashes, key, h); t != nullptr) {
+            t->value = std::forward<decltype(value)>(value);
+            return;
+        }
+        auto [i, found] = find_slot(key, h);
+        if (found) {
+            data[i].value = std::forward<decltype(value)>(value);
+            return;
+        }
+        data[i] = pair{
+            std::forward<decltype(key)>(key),
+            std::forward<decltype(value)>(value)
+        };
+        occupy(i, h);
+    }
+
+    auto emplace(auto&& key, size_t h, auto&&... args) -> std::pair<V&, bool> {
+        step();
+        if (cap() == 0 || payload() > 0.6) grow();
+        if (auto t = find(old_data, old_state, old_hashes, key, h); t != nullptr) return { t->value, false };
+        auto [i, found] = find_slot(key, h);
+        if (found) return { data[i].value, false };
+        data[i].key = std::forward<decltype(key)>(key);
+        data[i].value = V(std::forward<decltype(args)>(args)...);
+        occupy(i, h);
+        return { data[i].value, true };
+    }
+
+    static constexpr size_t batch = 16;
+
+    // hashes a batch of keys and prefetches their first groups before resolving any of them,
+    // so that the cache misses of a batch overlap;
+    void prefetched(slice<const K> keys, auto&& fn) {
+        size_t h[batch];
+        for (size_t b = 0; b < keys.size(); b += batch) {
+            auto n = std::min(batch, keys.size() - b);
+            for (size_t i = 0; i < n; i++) {
+                h[i] = hash(keys[b + i]);
+                prefetch(&state[ctrl::h1(h[i]) & mask()]);
+                prefetch(&data[ctrl::h1(h[i]) & mask()]);
             }
+            for (size_t i = 0; i < n; i++) fn(b + i, h[i]);
         }
-        return nullptr;
     }
 
     size_t first() {
         for (auto i : urange(data)) {
-            if (state[i].occupied) return i;
+            if (ctrl::is_full(state[i])) return i;
         }
         return data.size();
     }
 public:
-    hashmap(size_t min_cap = 16) : data(min_cap), state(min_cap) {}
+    hashmap(size_t min_cap = 16) :
+        data(std::bit_ceil(std::max(min_cap, group::width))), state(make_state(data.size())),
+        hashes(cache ? data.size() : 0, uninit) {}
     hashmap(std::initializer_list<pair> l) :
-        data(l.size() + l.size() / 2) , state(l.size() + l.size() / 2) {
+        data(std::bit_ceil(std::max(l.size() + l.size() / 2, group::width))), state(make_state(data.size())),
+        hashes(cache ? data.size() : 0, uninit) {
         for (auto&& [k, v] : l) set(std::move(k), std::move(v));
     }
 
-    auto& set(convertible_to<K> auto&& key, convertible_to<V> auto&& value) {
-        if (cap() == 0 || payload() > 0.6) grow();
-        for (size_t i = hash(key) % cap(), j = 0; j < cap(); i = (i+1) % cap(), j++) {
-            if (!state[i].occupied) {
-                data[i] = pair{
-                    std::forward<decltype(key)>(key),
-                    std::forward<decltype(value)>(value)
-                };
-                state[i].occupied = true;
-                len++;
-                break;
-            } else if (data[i].key == key) {
-                data[i].value = std::forward<decltype(value)>(value);
-                break;
-            } else {
-                state[i].conflict = true;
-            }
+    // in incremental mode, growing keeps the old table and every following insertion or removal
+    // moves a bounded number of its slots, instead of moving all of them at once;
+    // as without it, only calls that change the map, and iterating, move elements,
+    // so references returned by get stay valid across get, contains and their _many forms;
+    auto& incremental(bool on = true) {
+        gradual = on;
+        if (!on) finish();
+        return *this;
+    }
+
+    // grows once, up front, so that n elements fit without growing again;
+    auto& reserve(size_t n) {
+        finish();
+        if (cap() == 0 || (double)(n + tomb) / (double)cap() > 0.6) {
+            grow(std::bit_ceil(std::max({ (size_t)(n / 0.6) + 1, cap(), group::width })), false);
         }
         return *this;
     }
 
+    auto& set(convertible_to<K> auto&& key, convertible_to<V> auto&& value) {
+        auto h = hash(key);
+        insert(std::forward<decltype(key)>(key), std::forward<decltype(value)>(value), h);
+        return *this;
+    }
+
+    auto& set_many(slice<const K> keys, slice<const V> values) {
+        prefetched(keys, [&](size_t i, size_t h) { insert(keys[i], values[i], h); });
+        return *this;
+    }
+
+    // constructs the value from args only if key is missing;
+    // returns the value of key and whether it was inserted;
+    auto try_emplace(convertible_to<K> auto&& key, auto&&... args) -> std::pair<V&, bool> {
+        auto h = hash(key);
+        return emplace(std::forward<decltype(key)>(key), h, std::forward<decltype(args)>(args)...);
+    }
+
+    auto& get_or_insert(convertible_to<K> auto&& key, convertible_to<V> auto&& value) {
+        return try_emplace(std::forward<decltype(key)>(key), std::forward<decltype(value)>(value)).first;
+    }
+
+    // calls fn on the value of key, which is default constructed first if key is missing;
+    auto& upsert(convertible_to<K> auto&& key, std::invocable<V&> auto&& fn) {
+        auto& value = try_emplace(std::forward<decltype(key)>(key)).first;
+        fn(value);
+        return value;
+    }
+
     auto contains(const K& key) {
         return find(key) != nullptr;
     }
 
+    // looks up string keys from a slice<char> or a C string, without building a string;
+    auto contains(const hashable_as<K> auto& key) {
+        return find(key) != nullptr;
+    }
+
     auto get(const K& key) -> std::optional<std::reference_wrapper<V>> {
         if (auto t = find(key); t != nullptr) return t->value;
         return std::nullopt;
     }
 
+    auto get(const hashable_as<K> auto& key) -> std::optional<std::reference_wrapper<V>> {
+        if (auto t = find(key); t != nullptr) return t->value;
+        return std::nullopt;
+    }
+
+    void contains_many(slice<const K> keys, slice<bool> out) {
+        prefetched(keys, [&](size_t i, size_t h) { out[i] = find(keys[i], h) != nullptr; });
+    }
+
+    void get_many(slice<const K> keys, slice<std::optional<std::reference_wrapper<V>>> out) {
+        prefetched(keys, [&](size_t i, size_t h) {
+            if (auto t = find(keys[i], h); t != nullptr) out[i] = t->value;
+            else out[i] = std::nullopt;
+        });
+    }
+
     auto remove(const K& key) {
+        step();
         if (auto t = find(key); t != nullptr) {
-            state[t - data.begin()].occupied = false;
-            len--;
+            erase(t);
             return true;
         }
         return false;
@@ -114,16 +377,21 @@ public:
         auto& operator++() {
             do {
                 index++;
-            } while (index < map->data.size() && !map->state[index].occupied);
+            } while (index < map->data.size() && !ctrl::is_full(map->state[index]));
             return *this;
         }
         auto operator!=(iter& i) { return index != i.index; }
         auto& operator*() { return map->data[index]; }
     };
 
-    auto begin() { return iter{ this, first() }; }
+    // iterating finishes a pending incremental resize, as it visits every slot anyway,
+    // which moves elements as an insertion would;
+    auto begin() { finish(); return iter{ this, first() }; }
     auto end() { return iter{ this, data.size() }; }
     auto size() { return len; }
 };
 
+template<hashable K, typename V, bool cache>
+struct is_trivially_relocatable<hashmap<K, V, cache>> : std::true_type {};
+
 }
\ No newline at end of file
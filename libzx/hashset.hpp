@@ -1,81 +1,217 @@
 #pragma once
 #include <initializer_list>
 #include "hash.hpp"
+#include "probe.hpp"
 #include "range.hpp"
 #include "concepts.hpp"
 #include "smart_array.hpp"
 
 namespace libzx {
 
-template<hashable T>
+// with cache set, the full hash of every element is kept in a parallel array, as in hashmap;
+template<hashable T, bool cache = !std::is_trivially_copyable_v<T>>
 class hashset {
 protected:
-    struct status { uint8_t occupied : 1, conflict : 1; };
-
     unique_array<T> data;
-    unique_array<status> state;
-    size_t len = 0;
+    unique_array<int8_t> state;
+    unique_array<size_t> hashes;
+    size_t len = 0, tomb = 0;
     size_t cap() { return data.size(); }
-    double payload() { return (double)len / (double)data.size(); }
+    size_t mask() { return data.size() - 1; }
+    double payload() { return (double)(len + tomb) / (double)data.size(); }
+
+    static auto make_state(size_t cap) {
+        auto state = unique_array<int8_t>(cap + group::width, uninit);
+        std::fill(state.begin(), state.end(), ctrl::empty);
+        return state;
+    }
+
+    void mark(size_t i, int8_t c) {
+        state[i] = c;
+        if (i < group::width) state[cap() + i] = c;
+    }
+
+    static size_t hash_at(unique_array<T>& data, unique_array<size_t>& hashes, size_t i) {
+        if constexpr (cache) return hashes[i];
+        else return hash(data[i]);
+    }
 
+    void remember(size_t i, size_t h) {
+        if constexpr (cache) hashes[i] = h;
+    }
+
+    // when deleted slots dominate, they are cleared without reallocating instead;
     void grow() {
-        auto new_cap = data.size() * 2 + 1;
-        auto new_data = unique_array<T>(new_cap);
-        auto new_state = unique_array<status>(new_cap);
+        if (tomb > len) return rehash();
+        auto old_data = std::move(data);
+        auto old_state = std::move(state);
+        auto old_hashes = std::move(hashes);
+        auto new_cap = std::max(old_data.size() * 2, group::width);
+        data = unique_array<T>(new_cap, uninit);
+        state = make_state(new_cap);
+        if constexpr (cache) hashes = unique_array<size_t>(new_cap, uninit);
+        for (auto i : urange(old_data)) {
+            if (!ctrl::is_full(old_state[i])) continue;
+            auto h = hash_at(old_data, old_hashes, i);
+            auto j = find_free(h);
+            relocate_over(&old_data[i], 1, &data[j]);
+            remember(j, h);
+            mark(j, ctrl::h2(h));
+        }
+        tomb = 0;
+    }
+
+    // moves every element to the first free slot of its probe sequence, in place;
+    void rehash() {
         for (auto i : urange(data)) {
-            if (!state[i].occupied) continue;
-            for (size_t j = hash(data[i]) % new_cap, k = 0; k < new_cap; j = (j+1) % new_cap, k++) {
-                if (new_state[j].occupied) {
-                    new_state[j].conflict = true;
-                    continue;
+            state[i] = ctrl::is_full(state[i]) ? ctrl::deleted : ctrl::empty;
+        }
+        std::copy(state.begin(), state.begin() + group::width, state.begin() + cap());
+        for (size_t i = 0; i < cap();) {
+            if (state[i] != ctrl::deleted) { i++; continue; }
+            auto h = hash_at(data, hashes, i);
+            auto j = find_free(h);
+            auto start = ctrl::h1(h) & mask();
+            auto probe = [&](size_t k) { return ((k - start) & mask()) / group::width; };
+            if (probe(i) == probe(j)) {
+                mark(i, ctrl::h2(h));
+                i++;
+            } else if (state[j] == ctrl::empty) {
+                relocate_over(&data[i], 1, &data[j]);
+                remember(j, h);
+                mark(j, ctrl::h2(h));
+                mark(i, ctrl::empty);
+                i++;
+            } else {
+                std::swap(data[i], data[j]);
+                if constexpr (cache) std::swap(hashes[i], hashes[j]);
+                mark(j, ctrl::h2(h));
+            }
+        }
+        tomb = 0;
+    }
+
+    // a slot may become empty again if no group could have seen it full without an empty slot;
+    void erase(size_t i) {
+        auto after = group(&state[i]).match_empty();
+        auto before = group(&state[(i - group::width) & mask()]).match_empty();
+        if (after && before && after.trailing_zeros() + before.leading_zeros() < group::width) {
+            mark(i, ctrl::empty);
+        } else {
+            mark(i, ctrl::deleted);
+            tomb++;
+        }
+        len--;
+    }
+
+    // probes a group per step, comparing keys only where the stored hash bits match;
+    auto find(const auto& key, size_t h) -> T* {
+        for (size_t i = ctrl::h1(h) & mask(), j = 0; j < cap(); i = (i + group::width) & mask(), j += group::width) {
+            auto g = group(&state[i]);
+            for (auto k : g.match(ctrl::h2(h))) {
+                if constexpr (cache) {
+                    if (hashes[(i + k) & mask()] != h) continue;
                 }
-                new_data[j] = std::move(data[i]);
-                new_state[j].occupied = true;
-                break;
+                auto& t = data[(i + k) & mask()];
+                if (t == key) return &t;
             }
+            if (g.match_empty()) break;
         }
-        data = std::move(new_data);
-        state = std::move(new_state);
+        return nullptr;
     }
 
     auto find(const T& key) -> T* {
-        for (size_t i = hash(key) % cap(), j = 0; j < cap(); i = (i+1) % cap(), j++) {
-            if (state[i].occupied && data[i] == key) {
-                return &data[i];
+        return find(key, hash(key));
+    }
+
+    auto find(const hashable_as<T> auto& key) -> T* {
+        return find(key, hash(key));
+    }
+
+    // there is always a free slot, since the table grows before it fills up;
+    size_t find_free(size_t h) {
+        for (size_t i = ctrl::h1(h) & mask(); ; i = (i + group::width) & mask()) {
+            if (auto m = group(&state[i]).match_free()) return (i + m.trailing_zeros()) & mask();
+        }
+    }
+
+    // finds key and, on the way, the first free slot it could be put in;
+    auto find_slot(const auto& key, size_t h) -> std::pair<size_t, bool> {
+        size_t free = cap();
+        for (size_t i = ctrl::h1(h) & mask(), j = 0; j < cap(); i = (i + group::width) & mask(), j += group::width) {
+            auto g = group(&state[i]);
+            for (auto k : g.match(ctrl::h2(h))) {
+                if constexpr (cache) {
+                    if (hashes[(i + k) & mask()] != h) continue;
+                }
+                if (data[(i + k) & mask()] == key) return { (i + k) & mask(), true };
             }
-            if (!state[i].conflict) {
-                break;
+            if (auto m = g.match_free(); m && free == cap()) free = (i + m.trailing_zeros()) & mask();
+            if (g.match_empty()) break;
+        }
+        return { free, false };
+    }
+
+    void insert(auto&& key, size_t h) {
+        auto [i, found] = find_slot(key, h);
+        if (found) return;
+        if (state[i] == ctrl::deleted) tomb--;
+        data[i] = std::forward<decltype(key)>(key);
+        remember(i, h);
+        mark(i, ctrl::h2(h));
+        len++;
+    }
+
+    // grows until n elements fit without growing again;
+    void reserve(size_t n) {
+        while (cap() == 0 || (double)(n + tomb) / (double)cap() > 0.6) grow();
+    }
+
+    static constexpr size_t batch = 16;
+
+    // hashes a batch of keys and prefetches their first groups before resolving any of them,
+    // so that the cache misses of a batch overlap;
+    void prefetched(slice<const T> keys, auto&& fn) {
+        size_t h[batch];
+        for (size_t b = 0; b < keys.size(); b += batch) {
+            auto n = std::min(batch, keys.size() - b);
+            for (size_t i = 0; i < n; i++) {
+                h[i] = hash(keys[b + i]);
+                prefetch(&state[ctrl::h1(h[i]) & mask()]);
+                prefetch(&data[ctrl::h1(h[i]) & mask()]);
             }
+            for (size_t i = 0; i < n; i++) fn(b + i, h[i]);
         }
-        return nullptr;
     }
 
     size_t first() {
         for (auto i : urange(data)) {
-            if (state[i].occupied) return i;
+            if (ctrl::is_full(state[i])) return i;
         }
         return data.size();
     }
 public:
-    hashset(size_t min_cap = 16) : data(min_cap), state(min_cap) {}
+    hashset(size_t min_cap = 16) :
+        data(std::bit_ceil(std::max(min_cap, group::width))), state(make_state(data.size())),
+        hashes(cache ? data.size() : 0, uninit) {}
     hashset(std::initializer_list<T> l) :
-        data(l.size() + l.size() / 2) , state(l.size() + l.size() / 2) {
+        data(std::bit_ceil(std::max(l.size() + l.size() / 2, group::width))), state(make_state(data.size())),
+        hashes(cache ? data.size() : 0, uninit) {
         for (auto&& i : l) put(std::move(i));
     }
 
     auto& put(convertible_to<T> auto&& key) {
         if (cap() == 0 || payload() > 0.6) grow();
-        for (size_t i = hash(key) % cap(), j = 0; j < cap(); i = (i+1) % cap(), j++) {
-            if (!state[i].occupied) {
-                data[i] = std::forward<decltype(key)>(key);
-                state[i].occupied = true;
-                len++;
-                break;
-            } else if (data[i] == key) {
-                break;
-            } else {
-                state[i].conflict = true;
-            }
+        auto h = hash(key);
+        insert(std::forward<decltype(key)>(key), h);
+        return *this;
+    }
+
+    auto& put_many(slice<const T> keys) {
+        for (size_t b = 0; b < keys.size(); b += batch) {
+            auto part = keys.sub(b, b + batch);
+            reserve(len + part.size());
+            prefetched(part, [&](size_t i, size_t h) { insert(part[i], h); });
         }
         return *this;
     }
@@ -84,10 +220,18 @@ public:
         return find(key) != nullptr;
     }
 
+    // looks up string keys from a slice<char> or a C string, without building a string;
+    bool contains(const hashable_as<T> auto& key) {
+        return find(key) != nullptr;
+    }
+
+    void contains_many(slice<const T> keys, slice<bool> out) {
+        prefetched(keys, [&](size_t i, size_t h) { out[i] = find(keys[i], h) != nullptr; });
+    }
+
     auto remove(const T& key) {
         if (auto t = find(key); t != nullptr) {
-            state[t - data.begin()].occupied = false;
-            len--;
+            erase(t - data.begin());
             return true;
         }
         return false;
@@ -99,7 +243,7 @@ public:
         auto& operator++() {
             do {
                 index++;
-            } while (index < set->data.size() && !set->state[index].occupied);
+            } while (index < set->data.size() && !ctrl::is_full(set->state[index]));
             return *this;
         }
         auto operator!=(iter& i) { return index != i.index; }
@@ -111,4 +255,7 @@ public:
     auto size() { return len; }
 };
 
+template<hashable T, bool cache>
+struct is_trivially_relocatable<hashset<T, cache>> : std::true_type {};
+
 }
\ No newline at end of file
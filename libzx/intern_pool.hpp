@@ -0,0 +1,144 @@
+#pragma once
+#include <bit>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include "hashset.hpp"
+#include "string.hpp"
+#include "vector.hpp"
+
+namespace libzx {
+
+// intern_pool stores every distinct string once and names it by a small integer id;
+// equal strings get equal ids, so interned strings hash and compare as integers;
+// chars and entries are kept in blocks that never move, so views stay valid as long as the pool,
+// and reading a view needs no lock; interning shares the lock until it has to add a string;
+class intern_pool {
+public:
+    using id = uint32_t;
+protected:
+    // chars points into the arena, with a terminating 0 after the last one;
+    struct entry {
+        const char* chars;
+        uint32_t len;
+        id index;
+
+        bool operator==(const entry& e) const { return len == e.len && memcmp(chars, e.chars, len) == 0; }
+        friend size_t hash(const entry& e) { return libzx::hash(e.chars, e.len); }
+    };
+
+    struct table : hashset<entry, true> {
+        using base = hashset<entry, true>;
+
+        auto find(const entry& e, size_t h) { return base::find(e, h); }
+        void add(const entry& e, size_t h) {
+            if (base::cap() == 0 || base::payload() > 0.6) base::grow();
+            base::insert(e, h);
+        }
+    };
+
+    // segment k holds the entries of ids [base * (2^k - 1), base * (2^(k+1) - 1)),
+    // so that 23 segments cover every id and none of them is ever reallocated;
+    static constexpr size_t base = 1024, segments = 23, block = 64 * 1024;
+
+    mutable table set;
+    unique_array<entry> entries[segments];
+    vector<unique_array<char>> arena;
+    size_t used = block;
+    size_t count = 0;
+    mutable std::shared_mutex lock;
+
+    const entry& at(id i) const {
+        size_t j = i + base, k = std::bit_width(j / base) - 1;
+        return entries[k][j - (base << k)];
+    }
+
+    // copies s to the arena, whose last block is the one being filled;
+    // a string longer than a block gets a block of its own, put before the last one,
+    // so that the block being filled and how much of it is used stay as they were;
+    const char* store(const char* s, size_t n) {
+        if (n + 1 > block) {
+            arena.push_back(unique_array<char>(n + 1, uninit));
+            auto p = arena.back().begin();
+            if (arena.size() > 1) std::swap(arena[arena.size() - 1], arena[arena.size() - 2]);
+            memcpy(p, s, n);
+            p[n] = 0;
+            return p;
+        }
+        if (block - used < n + 1) {
+            arena.push_back(unique_array<char>(block, uninit));
+            used = 0;
+        }
+        auto p = arena.back().begin() + used;
+        memcpy(p, s, n);
+        p[n] = 0;
+        used += n + 1;
+        return p;
+    }
+
+    id intern(const char* s, size_t n) {
+        if (n > UINT32_MAX) throw std::length_error("intern_pool: string longer than 2^32 - 1 chars");
+        auto h = libzx::hash(s, n);
+        auto key = entry{ s, static_cast<uint32_t>(n), 0 };
+        {
+            std::shared_lock l(lock);
+            if (auto e = set.find(key, h); e != nullptr) return e->index;
+        }
+        std::unique_lock l(lock);
+        if (auto e = set.find(key, h); e != nullptr) return e->index;
+        if (count > UINT32_MAX) throw std::length_error("intern_pool: more than 2^32 strings");
+        auto i = static_cast<id>(count);
+        size_t j = i + base, k = std::bit_width(j / base) - 1;
+        if (entries[k].size() == 0) entries[k] = unique_array<entry>(base << k, uninit);
+        auto e = entry{ store(s, n), key.len, i };
+        entries[k][j - (base << k)] = e;
+        set.add(e, h);
+        count++;
+        return i;
+    }
+
+    std::optional<id> find(const char* s, size_t n) const {
+        if (n > UINT32_MAX) return std::nullopt;
+        auto h = libzx::hash(s, n);
+        std::shared_lock l(lock);
+        auto e = set.find(entry{ s, static_cast<uint32_t>(n), 0 }, h);
+        if (e == nullptr) return std::nullopt;
+        return e->index;
+    }
+public:
+    intern_pool() = default;
+    intern_pool(const intern_pool&) = delete;
+    intern_pool& operator=(const intern_pool&) = delete;
+
+    // returns the id of s, adding it first if it is new;
+    id intern(const string& s)      { return intern(s.begin(), s.size()); }
+    id intern(const slice<char>& s) { return intern(s.begin(), s.size()); }
+    id intern(const char* s)        { return intern(s, strlen(s)); }
+
+    // returns the id of s only if it was interned before;
+    std::optional<id> find(const string& s) const      { return find(s.begin(), s.size()); }
+    std::optional<id> find(const slice<char>& s) const { return find(s.begin(), s.size()); }
+    std::optional<id> find(const char* s) const        { return find(s, strlen(s)); }
+
+    // i must have been returned by intern;
+    slice<const char> view(id i) const {
+        auto& e = at(i);
+        return slice<const char>(e.chars, e.chars + e.len);
+    }
+
+    const char* c_str(id i) const { return at(i).chars; }
+
+    string str(id i) const {
+        auto& e = at(i);
+        string s;
+        s.append(e.chars, e.len);
+        return s;
+    }
+
+    size_t size() const {
+        std::shared_lock l(lock);
+        return count;
+    }
+};
+
+}
@@ -0,0 +1,765 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <type_traits>
+#include "concepts.hpp"
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(LIBZX_NO_SIMD)
+#include <emmintrin.h>
+#define LIBZX_SSE2 1
+#endif
+#if defined(LIBZX_SSE2) && (defined(__GNUC__) || defined(__clang__))
+// GCC 12 warns inside its own AVX-512 intrinsics, whose results start out undefined;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#define LIBZX_DISPATCH 1
+#endif
+
+namespace libzx {
+
+// kernels scan slices of numbers for the functions of algorithm.hpp, and the bytes of slices
+// for their comparisons, a vector at a time;
+// each instruction set has its own code, and dispatch runs the widest one that the CPU supports
+// and that has code for T; the others are portable loops, which also do what is left after the last vector;
+namespace kernels {
+    struct find {};
+    struct count {};
+    struct min_max {};
+    struct sum {};
+    struct dot {};
+    struct mismatch {};
+
+    // the type sums and dot products are kept in: floats keep their own, integers widen to 64 bits;
+    template<typename T>
+    using wide = std::conditional_t<std::is_floating_point_v<T>, T,
+        std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>>;
+
+    template<typename T>
+    constexpr bool is_float = std::is_floating_point_v<T>;
+
+    // integer sums and products wrap around on overflow, as unsigned ones do;
+    template<typename W>
+    W plus(W a, W b) {
+        if constexpr (is_float<W>) return a + b;
+        else return static_cast<W>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+    }
+
+    template<typename W>
+    W times(W a, W b) {
+        if constexpr (is_float<W>) return a * b;
+        else return static_cast<W>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+    }
+
+    struct scalar {
+        // the first i at which p[i] == v is equal, or n;
+        template<typename T>
+        static size_t run(find, const T* p, size_t n, T v, bool equal) {
+            for (size_t i = 0; i < n; i++) if ((p[i] == v) == equal) return i;
+            return n;
+        }
+
+        template<typename T>
+        static size_t run(count, const T* p, size_t n, T v) {
+            size_t c = 0;
+            for (size_t i = 0; i < n; i++) c += p[i] == v;
+            return c;
+        }
+
+        // NaNs are passed over, unless the first element is one; n is not 0;
+        template<typename T>
+        static std::pair<T, T> run(min_max, const T* p, size_t n) {
+            T lo = p[0], hi = p[0];
+            for (size_t i = 1; i < n; i++) {
+                if (p[i] < lo) lo = p[i];
+                if (hi < p[i]) hi = p[i];
+            }
+            return { lo, hi };
+        }
+
+        template<typename T>
+        static wide<T> run(sum, const T* p, size_t n) {
+            wide<T> r = 0;
+            for (size_t i = 0; i < n; i++) r = plus(r, wide<T>(p[i]));
+            return r;
+        }
+
+        template<typename T>
+        static wide<T> run(dot, const T* a, const T* b, size_t n) {
+            wide<T> r = 0;
+            for (size_t i = 0; i < n; i++) r = plus(r, times(wide<T>(a[i]), wide<T>(b[i])));
+            return r;
+        }
+
+        // the first i at which a[i] != b[i], or n; bytes are compared 8 at a time;
+        static size_t run(mismatch, const uint8_t* a, const uint8_t* b, size_t n) {
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                uint64_t x, y;
+                memcpy(&x, a + i, 8);
+                memcpy(&y, b + i, 8);
+                if (x == y) continue;
+                auto d = std::endian::native == std::endian::little ? std::countr_zero(x ^ y) : std::countl_zero(x ^ y);
+                return i + d / 8;
+            }
+            for (; i < n; i++) if (a[i] != b[i]) return i;
+            return n;
+        }
+    };
+
+    // min and max of what vectors found, with what is left after them;
+    template<typename T, size_t k>
+    std::pair<T, T> merge(const T (&lo)[k], const T (&hi)[k], const T* p, size_t n) {
+        auto l = scalar::run(min_max{}, lo, k).first, h = scalar::run(min_max{}, hi, k).second;
+        if (n == 0) return { l, h };
+        auto [tl, th] = scalar::run(min_max{}, p, n);
+        return { tl < l ? tl : l, h < th ? th : h };
+    }
+
+#ifdef LIBZX_SSE2
+    struct sse2 {
+        using V = __m128i;
+        static constexpr size_t width = 16;
+
+        static V load(const void* p) { return _mm_loadu_si128(static_cast<const V*>(p)); }
+
+        template<typename T>
+        static V set1(T v) {
+            if constexpr (std::is_same_v<T, float>) return _mm_castps_si128(_mm_set1_ps(v));
+            else if constexpr (std::is_same_v<T, double>) return _mm_castpd_si128(_mm_set1_pd(v));
+            else if constexpr (sizeof(T) == 1) return _mm_set1_epi8(static_cast<char>(v));
+            else if constexpr (sizeof(T) == 2) return _mm_set1_epi16(static_cast<short>(v));
+            else if constexpr (sizeof(T) == 4) return _mm_set1_epi32(static_cast<int>(v));
+            else return _mm_set1_epi64x(static_cast<long long>(v));
+        }
+
+        // all ones in the lanes where a equals b;
+        template<typename T>
+        static V eq(V a, V b) {
+            if constexpr (std::is_same_v<T, float>) {
+                return _mm_castps_si128(_mm_cmpeq_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b)));
+            } else if constexpr (std::is_same_v<T, double>) {
+                return _mm_castpd_si128(_mm_cmpeq_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b)));
+            } else if constexpr (sizeof(T) == 1) {
+                return _mm_cmpeq_epi8(a, b);
+            } else if constexpr (sizeof(T) == 2) {
+                return _mm_cmpeq_epi16(a, b);
+            } else if constexpr (sizeof(T) == 4) {
+                return _mm_cmpeq_epi32(a, b);
+            } else {
+                auto m = _mm_cmpeq_epi32(a, b);
+                return _mm_and_si128(m, _mm_shuffle_epi32(m, 0xB1));
+            }
+        }
+
+        // a bit for each byte of the lanes of m;
+        static uint64_t bits(V m) { return static_cast<uint32_t>(_mm_movemask_epi8(m)); }
+
+        static uint64_t add_up(V v) {
+            uint64_t l[2];
+            memcpy(l, &v, sizeof(l));
+            return l[0] + l[1];
+        }
+
+        // acc plus the next vector of floats at p, or of their products with those at q;
+        template<typename T>
+        static V add(V acc, const T* p) {
+            if constexpr (std::is_same_v<T, float>) return _mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(acc), _mm_loadu_ps(p)));
+            else return _mm_castpd_si128(_mm_add_pd(_mm_castsi128_pd(acc), _mm_loadu_pd(p)));
+        }
+
+        template<typename T>
+        static V add(V acc, const T* p, const T* q) {
+            if constexpr (std::is_same_v<T, float>) {
+                return _mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(acc), _mm_mul_ps(_mm_loadu_ps(p), _mm_loadu_ps(q))));
+            } else {
+                return _mm_castpd_si128(_mm_add_pd(_mm_castsi128_pd(acc), _mm_mul_pd(_mm_loadu_pd(p), _mm_loadu_pd(q))));
+            }
+        }
+
+        template<typename T>
+        static size_t run(find, const T* p, size_t n, T v, bool equal) {
+            constexpr size_t k = width / sizeof(T);
+            uint64_t flip = equal ? 0 : 0xFFFF;
+            auto b = set1(v);
+            size_t i = 0;
+            for (; i + 4 * k <= n; i += 4 * k) {
+                uint64_t m[4];
+                for (size_t j = 0; j < 4; j++) m[j] = bits(eq<T>(load(p + i + j * k), b)) ^ flip;
+                if ((m[0] | m[1] | m[2] | m[3]) == 0) continue;
+                for (size_t j = 0;; j++) if (m[j] != 0) return i + j * k + std::countr_zero(m[j]) / sizeof(T);
+            }
+            return i + scalar::run(find{}, p + i, n - i, v, equal);
+        }
+
+        static size_t run(mismatch, const uint8_t* a, const uint8_t* b, size_t n) {
+            size_t i = 0;
+            for (; i + 4 * width <= n; i += 4 * width) {
+                uint64_t m[4];
+                for (size_t j = 0; j < 4; j++) m[j] = bits(eq<uint8_t>(load(a + i + j * width), load(b + i + j * width))) ^ 0xFFFF;
+                if ((m[0] | m[1] | m[2] | m[3]) == 0) continue;
+                for (size_t j = 0;; j++) if (m[j] != 0) return i + j * width + std::countr_zero(m[j]);
+            }
+            for (; i + width <= n; i += width) {
+                auto m = bits(eq<uint8_t>(load(a + i), load(b + i))) ^ 0xFFFF;
+                if (m != 0) return i + std::countr_zero(m);
+            }
+            return i + scalar::run(mismatch{}, a + i, b + i, n - i);
+        }
+
+        // every byte of a lane that matches counts down from 0, and bytes are added up before they wrap;
+        template<typename T>
+        static size_t run(count, const T* p, size_t n, T v) {
+            constexpr size_t k = width / sizeof(T);
+            auto b = set1(v), zero = _mm_setzero_si128();
+            size_t i = 0, c = 0;
+            while (i + k <= n) {
+                auto acc = zero;
+                for (size_t j = 0; j < 255 && i + k <= n; j++, i += k) acc = _mm_sub_epi8(acc, eq<T>(load(p + i), b));
+                c += add_up(_mm_sad_epu8(acc, zero));
+            }
+            return c / sizeof(T) + scalar::run(count{}, p + i, n - i, v);
+        }
+
+        // SSE2 has min and max for these only;
+        template<typename T>
+        requires (is_float<T> || std::is_same_v<T, uint8_t> || std::is_same_v<T, int16_t>)
+        static std::pair<T, T> run(min_max, const T* p, size_t n) {
+            constexpr size_t k = width / sizeof(T);
+            auto lo = set1(p[0]), hi = lo;
+            size_t i = 0;
+            for (; i + k <= n; i += k) {
+                auto x = load(p + i);
+                if constexpr (std::is_same_v<T, float>) {
+                    lo = _mm_castps_si128(_mm_min_ps(_mm_castsi128_ps(x), _mm_castsi128_ps(lo)));
+                    hi = _mm_castps_si128(_mm_max_ps(_mm_castsi128_ps(x), _mm_castsi128_ps(hi)));
+                } else if constexpr (std::is_same_v<T, double>) {
+                    lo = _mm_castpd_si128(_mm_min_pd(_mm_castsi128_pd(x), _mm_castsi128_pd(lo)));
+                    hi = _mm_castpd_si128(_mm_max_pd(_mm_castsi128_pd(x), _mm_castsi128_pd(hi)));
+                } else if constexpr (sizeof(T) == 1) {
+                    lo = _mm_min_epu8(x, lo), hi = _mm_max_epu8(x, hi);
+                } else {
+                    lo = _mm_min_epi16(x, lo), hi = _mm_max_epi16(x, hi);
+                }
+            }
+            T l[k], h[k];
+            memcpy(l, &lo, sizeof(l));
+            memcpy(h, &hi, sizeof(h));
+            return merge(l, h, p + i, n - i);
+        }
+
+        // bytes are summed 8 at a time by _mm_sad_epu8, signed ones after adding 128 to them;
+        template<typename T>
+        requires (is_float<T> || sizeof(T) == 1 || sizeof(T) == 8)
+        static wide<T> run(sum, const T* p, size_t n) {
+            constexpr size_t k = width / sizeof(T);
+            size_t i = 0;
+            wide<T> r = 0;
+            if constexpr (is_float<T>) {
+                V acc[4] = {};
+                for (; i + 4 * k <= n; i += 4 * k) {
+                    for (size_t j = 0; j < 4; j++) acc[j] = add(acc[j], p + i + j * k);
+                }
+                T l[4 * k];
+                memcpy(l, acc, sizeof(l));
+                for (auto x : l) r += x;
+            } else {
+                auto acc = _mm_setzero_si128(), zero = acc, bias = set1<int8_t>(std::is_signed_v<T> ? -128 : 0);
+                for (; i + k <= n; i += k) {
+                    auto x = load(p + i);
+                    if constexpr (sizeof(T) == 1) acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_xor_si128(x, bias), zero));
+                    else acc = _mm_add_epi64(acc, x);
+                }
+                r = static_cast<wide<T>>(add_up(acc));
+                if constexpr (sizeof(T) == 1 && std::is_signed_v<T>) r -= static_cast<wide<T>>(128 * i);
+            }
+            return plus(r, scalar::run(sum{}, p + i, n - i));
+        }
+
+        template<typename T>
+        requires is_float<T>
+        static T run(dot, const T* a, const T* b, size_t n) {
+            constexpr size_t k = width / sizeof(T);
+            V acc[4] = {};
+            size_t i = 0;
+            for (; i + 4 * k <= n; i += 4 * k) {
+                for (size_t j = 0; j < 4; j++) acc[j] = add(acc[j], a + i + j * k, b + i + j * k);
+            }
+            T l[4 * k], r = 0;
+            memcpy(l, acc, sizeof(l));
+            for (auto x : l) r += x;
+            return plus(r, scalar::run(dot{}, a + i, b + i, n - i));
+        }
+    };
+#endif
+
+#ifdef LIBZX_DISPATCH
+    struct avx2 {
+        using V = __m256i;
+        static constexpr size_t width = 32;
+
+        [[gnu::target("avx2"), gnu::always_inline]]
+        static V load(const void* p) { return _mm256_loadu_si256(static_cast<const V*>(p)); }
+
+        template<typename T>
+        [[gnu::target("avx2"), gnu::always_inline]]
+        static V set1(T v) {
+            if constexpr (std::is_same_v<T, float>) return _mm256_castps_si256(_mm256_set1_ps(v));
+            else if constexpr (std::is_same_v<T, double>) return _mm256_castpd_si256(_mm256_set1_pd(v));
+            else if constexpr (sizeof(T) == 1) return _mm256_set1_epi8(static_cast<char>(v));
+            else if constexpr (sizeof(T) == 2) return _mm256_set1_epi16(static_cast<short>(v));
+            else if constexpr (sizeof(T) == 4) return _mm256_set1_epi32(static_cast<int>(v));
+            else return _mm256_set1_epi64x(static_cast<long long>(v));
+        }
+
+        template<typename T>
+        [[gnu::target("avx2"), gnu::always_inline]]
+        static V eq(V a, V b) {
+            if constexpr (std::is_same_v<T, float>) {
+                return _mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _CMP_EQ_OQ));
+            } else if constexpr (std::is_same_v<T, double>) {
+                return _mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(a), _mm256_castsi256_pd(b), _CMP_EQ_OQ));
+            } else if constexpr (sizeof(T) == 1) {
+                return _mm256_cmpeq_epi8(a, b);
+            } else if constexpr (sizeof(T) == 2) {
+                return _mm256_cmpeq_epi16(a, b);
+            } else if constexpr (sizeof(T) == 4) {
+                return _mm256_cmpeq_epi32(a, b);
+            } else {
+                return _mm256_cmpeq_epi64(a, b);
+            }
+        }
+
+        [[gnu::target("avx2"), gnu::always_inline]]
+        static uint64_t bits(V m) { return static_cast<uint32_t>(_mm256_movemask_epi8(m)); }
+
+        [[gnu::target("avx2"), gnu::always_inline]]
+        static uint64_t add_up(V v) {
+            uint64_t l[4];
+            memcpy(l, &v, sizeof(l));
+            return l[0] + l[1] + l[2] + l[3];
+        }
+
+        // the next 4 integers of p, widened to 64 bits;
+        template<typename T>
+        [[gnu::target("avx2"), gnu::always_inline]]
+        static V widen(const T* p) {
+            __m128i x;
+            if constexpr (sizeof(T) == 1) {
+                int32_t w;
+                memcpy(&w, p, sizeof(w));
+                x = _mm_cvtsi32_si128(w);
+            } else if constexpr (sizeof(T) == 2) {
+                x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+            } else {
+                x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            }
+            if constexpr (sizeof(T) == 1) return std::is_signed_v<T> ? _mm256_cvtepi8_epi64(x) : _mm256_cvtepu8_epi64(x);
+            else if constexpr (sizeof(T) == 2) return std::is_signed_v<T> ? _mm256_cvtepi16_epi64(x) : _mm256_cvtepu16_epi64(x);
+            else return std::is_signed_v<T> ? _mm256_cvtepi32_epi64(x) : _mm256_cvtepu32_epi64(x);
+        }
+
+        // acc plus the next vector of floats at p, or of their products with those at q;
+        template<typename T>
+        [[gnu::target("avx2"), gnu::always_inline]]
+        static V add(V acc, const T* p) {
+            if constexpr (std::is_same_v<T, float>) return _mm256_castps_si256(_mm256_add_ps(_mm256_castsi256_ps(acc), _mm256_loadu_ps(p)));
+            else return _mm256_castpd_si256(_mm256_add_pd(_mm256_castsi256_pd(acc), _mm256_loadu_pd(p)));
+        }
+
+        template<typename T>
+        [[gnu::target("avx2"), gnu::always_inline]]
+        static V add(V acc, const T* p, const T* q) {
+            if constexpr (std::is_same_v<T, float>) {
+                return _mm256_castps_si256(_mm256_add_ps(_mm256_castsi256_ps(acc), _mm256_mul_ps(_mm256_loadu_ps(p), _mm256_loadu_ps(q))));
+            } else {
+                return _mm256_castpd_si256(_mm256_add_pd(_mm256_castsi256_pd(acc), _mm256_mul_pd(_mm256_loadu_pd(p), _mm256_loadu_pd(q))));
+            }
+        }
+
+        template<typename T>
+        [[gnu::target("avx2")]]
+        static size_t run(find, const T* p, size_t n, T v, bool equal) {
+            constexpr size_t k = width / sizeof(T);
+            uint64_t flip = equal ? 0 : 0xFFFFFFFF;
+            auto b = set1(v);
+            size_t i = 0;
+            for (; i + 4 * k <= n; i += 4 * k) {
+                uint64_t m[4];
+                for (size_t j = 0; j < 4; j++) m[j] = bits(eq<T>(load(p + i + j * k), b)) ^ flip;
+                if ((m[0] | m[1] | m[2] | m[3]) == 0) continue;
+                for (size_t j = 0;; j++) if (m[j] != 0) return i + j * k + std::countr_zero(m[j]) / sizeof(T);
+            }
+            return i + scalar::run(find{}, p + i, n - i, v, equal);
+        }
+
+        [[gnu::target("avx2")]]
+        static size_t run(mismatch, const uint8_t* a, const uint8_t* b, size_t n) {
+            size_t i = 0;
+            for (; i + 4 * width <= n; i += 4 * width) {
+                uint64_t m[4];
+                for (size_t j = 0; j < 4; j++) m[j] = bits(eq<uint8_t>(load(a + i + j * width), load(b + i + j * width))) ^ 0xFFFFFFFF;
+                if ((m[0] | m[1] | m[2] | m[3]) == 0) continue;
+                for (size_t j = 0;; j++) if (m[j] != 0) return i + j * width + std::countr_zero(m[j]);
+            }
+            for (; i + width <= n; i += width) {
+                auto m = bits(eq<uint8_t>(load(a + i), load(b + i))) ^ 0xFFFFFFFF;
+                if (m != 0) return i + std::countr_zero(m);
+            }
+            return i + scalar::run(mismatch{}, a + i, b + i, n - i);
+        }
+
+        template<typename T>
+        [[gnu::target("avx2")]]
+        static size_t run(count, const T* p, size_t n, T v) {
+            constexpr size_t k = width / sizeof(T);
+            auto b = set1(v), zero = _mm256_setzero_si256();
+            size_t i = 0, c = 0;
+            while (i + k <= n) {
+                auto acc = zero;
+                for (size_t j = 0; j < 255 && i + k <= n; j++, i += k) acc = _mm256_sub_epi8(acc, eq<T>(load(p + i), b));
+                c += add_up(_mm256_sad_epu8(acc, zero));
+            }
+            return c / sizeof(T) + scalar::run(count{}, p + i, n - i, v);
+        }
+
+        // AVX2 has no min or max of 64-bit integers, so they are picked by comparing,
+        // with unsigned ones moved to the signed range first;
+        template<typename T>
+        [[gnu::target("avx2")]]
+        static std::pair<T, T> run(min_max, const T* p, size_t n) {
+            constexpr size_t k = width / sizeof(T);
+            auto lo = set1(p[0]), hi = lo;
+            size_t i = 0;
+            for (; i + k <= n; i += k) {
+                auto x = load(p + i);
+                if constexpr (std::is_same_v<T, float>) {
+                    lo = _mm256_castps_si256(_mm256_min_ps(_mm256_castsi256_ps(x), _mm256_castsi256_ps(lo)));
+                    hi = _mm256_castps_si256(_mm256_max_ps(_mm256_castsi256_ps(x), _mm256_castsi256_ps(hi)));
+                } else if constexpr (std::is_same_v<T, double>) {
+                    lo = _mm256_castpd_si256(_mm256_min_pd(_mm256_castsi256_pd(x), _mm256_castsi256_pd(lo)));
+                    hi = _mm256_castpd_si256(_mm256_max_pd(_mm256_castsi256_pd(x), _mm256_castsi256_pd(hi)));
+                } else if constexpr (sizeof(T) == 1) {
+                    if constexpr (std::is_signed_v<T>) lo = _mm256_min_epi8(x, lo), hi = _mm256_max_epi8(x, hi);
+                    else lo = _mm256_min_epu8(x, lo), hi = _mm256_max_epu8(x, hi);
+                } else if constexpr (sizeof(T) == 2) {
+                    if constexpr (std::is_signed_v<T>) lo = _mm256_min_epi16(x, lo), hi = _mm256_max_epi16(x, hi);
+                    else lo = _mm256_min_epu16(x, lo), hi = _mm256_max_epu16(x, hi);
+                } else if constexpr (sizeof(T) == 4) {
+                    if constexpr (std::is_signed_v<T>) lo = _mm256_min_epi32(x, lo), hi = _mm256_max_epi32(x, hi);
+                    else lo = _mm256_min_epu32(x, lo), hi = _mm256_max_epu32(x, hi);
+                } else {
+                    auto bias = _mm256_set1_epi64x(std::is_signed_v<T> ? 0 : INT64_MIN);
+                    auto bx = _mm256_xor_si256(x, bias);
+                    lo = _mm256_blendv_epi8(lo, x, _mm256_cmpgt_epi64(_mm256_xor_si256(lo, bias), bx));
+                    hi = _mm256_blendv_epi8(hi, x, _mm256_cmpgt_epi64(bx, _mm256_xor_si256(hi, bias)));
+                }
+            }
+            T l[k], h[k];
+            memcpy(l, &lo, sizeof(l));
+            memcpy(h, &hi, sizeof(h));
+            return merge(l, h, p + i, n - i);
+        }
+
+        // floats are added up in 4 vectors at once, bytes 8 at a time by _mm256_sad_epu8,
+        // and other integers in 64 bits;
+        template<typename T>
+        [[gnu::target("avx2")]]
+        static wide<T> run(sum, const T* p, size_t n) {
+            constexpr size_t k = width / sizeof(T);
+            size_t i = 0;
+            wide<T> r = 0;
+            if constexpr (is_float<T>) {
+                V acc[4] = {};
+                for (; i + 4 * k <= n; i += 4 * k) {
+                    for (size_t j = 0; j < 4; j++) acc[j] = add(acc[j], p + i + j * k);
+                }
+                T l[4 * k];
+                memcpy(l, acc, sizeof(l));
+                for (auto x : l) r += x;
+            } else {
+                auto acc = _mm256_setzero_si256(), zero = acc;
+                if constexpr (sizeof(T) == 1) {
+                    auto bias = set1<int8_t>(std::is_signed_v<T> ? -128 : 0);
+                    for (; i + k <= n; i += k) acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_xor_si256(load(p + i), bias), zero));
+                } else if constexpr (sizeof(T) == 8) {
+                    for (; i + k <= n; i += k) acc = _mm256_add_epi64(acc, load(p + i));
+                } else {
+                    for (; i + 4 <= n; i += 4) acc = _mm256_add_epi64(acc, widen(p + i));
+                }
+                r = static_cast<wide<T>>(add_up(acc));
+                if constexpr (sizeof(T) == 1 && std::is_signed_v<T>) r -= static_cast<wide<T>>(128 * i);
+            }
+            return plus(r, scalar::run(sum{}, p + i, n - i));
+        }
+
+        // integers of up to 32 bits are widened to 64, and multiplied by _mm256_mul_epi32 or _mm256_mul_epu32;
+        template<typename T>
+        requires (sizeof(T) <= 4 || is_float<T>)
+        [[gnu::target("avx2")]]
+        static wide<T> run(dot, const T* a, const T* b, size_t n) {
+            constexpr size_t k = width / sizeof(T);
+            size_t i = 0;
+            wide<T> r = 0;
+            if constexpr (is_float<T>) {
+                V acc[4] = {};
+                for (; i + 4 * k <= n; i += 4 * k) {
+                    for (size_t j = 0; j < 4; j++) acc[j] = add(acc[j], a + i + j * k, b + i + j * k);
+                }
+                T l[4 * k];
+                memcpy(l, acc, sizeof(l));
+                for (auto x : l) r += x;
+            } else {
+                auto acc = _mm256_setzero_si256();
+                for (; i + 4 <= n; i += 4) {
+                    auto x = widen(a + i), y = widen(b + i);
+                    acc = _mm256_add_epi64(acc, std::is_signed_v<T> ? _mm256_mul_epi32(x, y) : _mm256_mul_epu32(x, y));
+                }
+                r = static_cast<wide<T>>(add_up(acc));
+            }
+            return plus(r, scalar::run(dot{}, a + i, b + i, n - i));
+        }
+    };
+
+    // AVX-512 compares into masks with a bit per lane, instead of into vectors;
+    struct avx512 {
+        using V = __m512i;
+        static constexpr size_t width = 64;
+
+        [[gnu::target("avx512f,avx512bw"), gnu::always_inline]]
+        static V load(const void* p) { return _mm512_loadu_si512(p); }
+
+        template<typename T>
+        [[gnu::target("avx512f,avx512bw"), gnu::always_inline]]
+        static V set1(T v) {
+            if constexpr (std::is_same_v<T, float>) return _mm512_castps_si512(_mm512_set1_ps(v));
+            else if constexpr (std::is_same_v<T, double>) return _mm512_castpd_si512(_mm512_set1_pd(v));
+            else if constexpr (sizeof(T) == 1) return _mm512_set1_epi8(static_cast<char>(v));
+            else if constexpr (sizeof(T) == 2) return _mm512_set1_epi16(static_cast<short>(v));
+            else if constexpr (sizeof(T) == 4) return _mm512_set1_epi32(static_cast<int>(v));
+            else return _mm512_set1_epi64(static_cast<long long>(v));
+        }
+
+        template<typename T>
+        [[gnu::target("avx512f,avx512bw"), gnu::always_inline]]
+        static uint64_t eq(V a, V b) {
+            if constexpr (std::is_same_v<T, float>) {
+                return _mm512_cmp_ps_mask(_mm512_castsi512_ps(a), _mm512_castsi512_ps(b), _CMP_EQ_OQ);
+            } else if constexpr (std::is_same_v<T, double>) {
+                return _mm512_cmp_pd_mask(_mm512_castsi512_pd(a), _mm512_castsi512_pd(b), _CMP_EQ_OQ);
+            } else if constexpr (sizeof(T) == 1) {
+                return _mm512_cmpeq_epi8_mask(a, b);
+            } else if constexpr (sizeof(T) == 2) {
+                return _mm512_cmpeq_epi16_mask(a, b);
+            } else if constexpr (sizeof(T) == 4) {
+                return _mm512_cmpeq_epi32_mask(a, b);
+            } else {
+                return _mm512_cmpeq_epi64_mask(a, b);
+            }
+        }
+
+        [[gnu::target("avx512f,avx512bw"), gnu::always_inline]]
+        static uint64_t add_up(V v) {
+            uint64_t l[8], r = 0;
+            memcpy(l, &v, sizeof(l));
+            for (auto x : l) r += x;
+            return r;
+        }
+
+        // the next 8 integers of p, widened to 64 bits;
+        template<typename T>
+        [[gnu::target("avx512f,avx512bw"), gnu::always_inline]]
+        static V widen(const T* p) {
+            if constexpr (sizeof(T) == 1) {
+                auto x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+                return std::is_signed_v<T> ? _mm512_cvtepi8_epi64(x) : _mm512_cvtepu8_epi64(x);
+            } else if constexpr (sizeof(T) == 2) {
+                auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                return std::is_signed_v<T> ? _mm512_cvtepi16_epi64(x) : _mm512_cvtepu16_epi64(x);
+            } else {
+                auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                return std::is_signed_v<T> ? _mm512_cvtepi32_epi64(x) : _mm512_cvtepu32_epi64(x);
+            }
+        }
+
+        // acc plus the next vector of floats at p, or of their products with those at q;
+        template<typename T>
+        [[gnu::target("avx512f,avx512bw"), gnu::always_inline]]
+        static V add(V acc, const T* p) {
+            if constexpr (std::is_same_v<T, float>) return _mm512_castps_si512(_mm512_add_ps(_mm512_castsi512_ps(acc), _mm512_loadu_ps(p)));
+            else return _mm512_castpd_si512(_mm512_add_pd(_mm512_castsi512_pd(acc), _mm512_loadu_pd(p)));
+        }
+
+        template<typename T>
+        [[gnu::target("avx512f,avx512bw"), gnu::always_inline]]
+        static V add(V acc, const T* p, const T* q) {
+            if constexpr (std::is_same_v<T, float>) {
+                return _mm512_castps_si512(_mm512_add_ps(_mm512_castsi512_ps(acc), _mm512_mul_ps(_mm512_loadu_ps(p), _mm512_loadu_ps(q))));
+            } else {
+                return _mm512_castpd_si512(_mm512_add_pd(_mm512_castsi512_pd(acc), _mm512_mul_pd(_mm512_loadu_pd(p), _mm512_loadu_pd(q))));
+            }
+        }
+
+        template<typename T>
+        [[gnu::target("avx512f,avx512bw")]]
+        static size_t run(find, const T* p, size_t n, T v, bool equal) {
+            constexpr size_t k = width / sizeof(T);
+            uint64_t flip = equal ? 0 : k == 64 ? ~uint64_t(0) : (uint64_t(1) << k) - 1;
+            auto b = set1(v);
+            size_t i = 0;
+            for (; i + 4 * k <= n; i += 4 * k) {
+                uint64_t m[4];
+                for (size_t j = 0; j < 4; j++) m[j] = eq<T>(load(p + i + j * k), b) ^ flip;
+                if ((m[0] | m[1] | m[2] | m[3]) == 0) continue;
+                for (size_t j = 0;; j++) if (m[j] != 0) return i + j * k + std::countr_zero(m[j]);
+            }
+            return i + scalar::run(find{}, p + i, n - i, v, equal);
+        }
+
+        [[gnu::target("avx512f,avx512bw")]]
+        static size_t run(mismatch, const uint8_t* a, const uint8_t* b, size_t n) {
+            size_t i = 0;
+            for (; i + 4 * width <= n; i += 4 * width) {
+                uint64_t m[4];
+                for (size_t j = 0; j < 4; j++) m[j] = eq<uint8_t>(load(a + i + j * width), load(b + i + j * width)) ^ ~uint64_t(0);
+                if ((m[0] | m[1] | m[2] | m[3]) == 0) continue;
+                for (size_t j = 0;; j++) if (m[j] != 0) return i + j * width + std::countr_zero(m[j]);
+            }
+            for (; i + width <= n; i += width) {
+                auto m = eq<uint8_t>(load(a + i), load(b + i)) ^ ~uint64_t(0);
+                if (m != 0) return i + std::countr_zero(m);
+            }
+            return i + scalar::run(mismatch{}, a + i, b + i, n - i);
+        }
+
+        template<typename T>
+        [[gnu::target("avx512f,avx512bw,popcnt")]]
+        static size_t run(count, const T* p, size_t n, T v) {
+            constexpr size_t k = width / sizeof(T);
+            auto b = set1(v);
+            size_t i = 0, c = 0;
+            for (; i + k <= n; i += k) c += std::popcount(eq<T>(load(p + i), b));
+            return c + scalar::run(count{}, p + i, n - i, v);
+        }
+
+        template<typename T>
+        [[gnu::target("avx512f,avx512bw")]]
+        static std::pair<T, T> run(min_max, const T* p, size_t n) {
+            constexpr size_t k = width / sizeof(T);
+            auto lo = set1(p[0]), hi = lo;
+            size_t i = 0;
+            for (; i + k <= n; i += k) {
+                auto x = load(p + i);
+                if constexpr (std::is_same_v<T, float>) {
+                    lo = _mm512_castps_si512(_mm512_min_ps(_mm512_castsi512_ps(x), _mm512_castsi512_ps(lo)));
+                    hi = _mm512_castps_si512(_mm512_max_ps(_mm512_castsi512_ps(x), _mm512_castsi512_ps(hi)));
+                } else if constexpr (std::is_same_v<T, double>) {
+                    lo = _mm512_castpd_si512(_mm512_min_pd(_mm512_castsi512_pd(x), _mm512_castsi512_pd(lo)));
+                    hi = _mm512_castpd_si512(_mm512_max_pd(_mm512_castsi512_pd(x), _mm512_castsi512_pd(hi)));
+                } else if constexpr (sizeof(T) == 1) {
+                    if constexpr (std::is_signed_v<T>) lo = _mm512_min_epi8(x, lo), hi = _mm512_max_epi8(x, hi);
+                    else lo = _mm512_min_epu8(x, lo), hi = _mm512_max_epu8(x, hi);
+                } else if constexpr (sizeof(T) == 2) {
+                    if constexpr (std::is_signed_v<T>) lo = _mm512_min_epi16(x, lo), hi = _mm512_max_epi16(x, hi);
+                    else lo = _mm512_min_epu16(x, lo), hi = _mm512_max_epu16(x, hi);
+                } else if constexpr (sizeof(T) == 4) {
+                    if constexpr (std::is_signed_v<T>) lo = _mm512_min_epi32(x, lo), hi = _mm512_max_epi32(x, hi);
+                    else lo = _mm512_min_epu32(x, lo), hi = _mm512_max_epu32(x, hi);
+                } else {
+                    if constexpr (std::is_signed_v<T>) lo = _mm512_min_epi64(x, lo), hi = _mm512_max_epi64(x, hi);
+                    else lo = _mm512_min_epu64(x, lo), hi = _mm512_max_epu64(x, hi);
+                }
+            }
+            T l[k], h[k];
+            memcpy(l, &lo, sizeof(l));
+            memcpy(h, &hi, sizeof(h));
+            return merge(l, h, p + i, n - i);
+        }
+
+        template<typename T>
+        [[gnu::target("avx512f,avx512bw")]]
+        static wide<T> run(sum, const T* p, size_t n) {
+            constexpr size_t k = width / sizeof(T);
+            size_t i = 0;
+            wide<T> r = 0;
+            if constexpr (is_float<T>) {
+                V acc[4] = {};
+                for (; i + 4 * k <= n; i += 4 * k) {
+                    for (size_t j = 0; j < 4; j++) acc[j] = add(acc[j], p + i + j * k);
+                }
+                T l[4 * k];
+                memcpy(l, acc, sizeof(l));
+                for (auto x : l) r += x;
+            } else {
+                auto acc = _mm512_setzero_si512(), zero = acc;
+                if constexpr (sizeof(T) == 1) {
+                    auto bias = set1<int8_t>(std::is_signed_v<T> ? -128 : 0);
+                    for (; i + k <= n; i += k) acc = _mm512_add_epi64(acc, _mm512_sad_epu8(_mm512_xor_si512(load(p + i), bias), zero));
+                } else if constexpr (sizeof(T) == 8) {
+                    for (; i + k <= n; i += k) acc = _mm512_add_epi64(acc, load(p + i));
+                } else {
+                    for (; i + 8 <= n; i += 8) acc = _mm512_add_epi64(acc, widen(p + i));
+                }
+                r = static_cast<wide<T>>(add_up(acc));
+                if constexpr (sizeof(T) == 1 && std::is_signed_v<T>) r -= static_cast<wide<T>>(128 * i);
+            }
+            return plus(r, scalar::run(sum{}, p + i, n - i));
+        }
+
+        template<typename T>
+        requires (sizeof(T) <= 4 || is_float<T>)
+        [[gnu::target("avx512f,avx512bw")]]
+        static wide<T> run(dot, const T* a, const T* b, size_t n) {
+            constexpr size_t k = width / sizeof(T);
+            size_t i = 0;
+            wide<T> r = 0;
+            if constexpr (is_float<T>) {
+                V acc[4] = {};
+                for (; i + 4 * k <= n; i += 4 * k) {
+                    for (size_t j = 0; j < 4; j++) acc[j] = add(acc[j], a + i + j * k, b + i + j * k);
+                }
+                T l[4 * k];
+                memcpy(l, acc, sizeof(l));
+                for (auto x : l) r += x;
+            } else {
+                auto acc = _mm512_setzero_si512();
+                for (; i + 8 <= n; i += 8) {
+                    auto x = widen(a + i), y = widen(b + i);
+                    acc = _mm512_add_epi64(acc, std::is_signed_v<T> ? _mm512_mul_epi32(x, y) : _mm512_mul_epu32(x, y));
+                }
+                r = static_cast<wide<T>>(add_up(acc));
+            }
+            return plus(r, scalar::run(dot{}, a + i, b + i, n - i));
+        }
+    };
+
+    // 2 with AVX-512, 1 with AVX2, and 0 with neither;
+    inline int level() {
+        static const int l = (__builtin_cpu_init(),
+            __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") ? 2 :
+            __builtin_cpu_supports("avx2") ? 1 : 0);
+        return l;
+    }
+#endif
+
+    // runs the kernel K on the widest instruction set that the CPU supports and that has code for it;
+    template<typename K, typename... A>
+    auto dispatch(A... a) {
+#ifdef LIBZX_DISPATCH
+        if constexpr (requires { avx512::run(K{}, a...); }) {
+            if (level() == 2) return avx512::run(K{}, a...);
+        }
+        if constexpr (requires { avx2::run(K{}, a...); }) {
+            if (level() >= 1) return avx2::run(K{}, a...);
+        }
+#endif
+#ifdef LIBZX_SSE2
+        if constexpr (requires { sse2::run(K{}, a...); }) return sse2::run(K{}, a...);
+#endif
+        return scalar::run(K{}, a...);
+    }
+}
+
+}
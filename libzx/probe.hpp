@@ -0,0 +1,102 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(LIBZX_NO_SIMD)
+#include <emmintrin.h>
+#define LIBZX_SSE2 1
+#endif
+
+namespace libzx {
+
+// control bytes of open addressing tables;
+// a full slot stores the low 7 bits of its hash, so the high bit tells free from full;
+namespace ctrl {
+    constexpr int8_t empty = -128;
+    constexpr int8_t deleted = -2;
+    constexpr int8_t sentinel = -1;
+
+    constexpr bool is_full(int8_t c) { return c >= 0; }
+    constexpr bool is_free(int8_t c) { return c < sentinel; }
+    constexpr size_t h1(size_t hash) { return hash >> 7; }
+    constexpr int8_t h2(size_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+}
+
+inline void prefetch(const void* p) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p);
+#elif defined(LIBZX_SSE2)
+    _mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#endif
+}
+
+// bitmask is the result of matching a group;
+// each matched slot owns `shift` bits, of which only the lowest one may be set;
+template<typename B, size_t width, size_t shift>
+class bitmask {
+protected:
+    static constexpr size_t unused = sizeof(B) * 8 - width * shift;
+    B bits;
+public:
+    struct iter {
+        B bits;
+        auto& operator++() { bits &= bits - 1; return *this; }
+        auto operator!=(const iter& i) const { return bits != i.bits; }
+        size_t operator*() const { return std::countr_zero(bits) / shift; }
+    };
+    explicit bitmask(B bits) : bits(bits) {}
+    explicit operator bool() const noexcept { return bits != 0; }
+    size_t trailing_zeros() const noexcept { return std::countr_zero(bits) / shift; }
+    size_t leading_zeros() const noexcept { return (std::countl_zero(bits) - unused) / shift; }
+    auto begin() const { return iter{ bits }; }
+    auto end() const { return iter{ 0 }; }
+};
+
+// group is a window of control bytes matched at once;
+// it may start at any slot, since tables mirror their first `width` control bytes at the end;
+#ifdef LIBZX_SSE2
+class group {
+protected:
+    __m128i ctrl;
+public:
+    static constexpr size_t width = 16;
+    explicit group(const int8_t* p) : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+
+    auto match(int8_t h2) const {
+        return bitmask<uint32_t, width, 1>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl)));
+    }
+    auto match_empty() const {
+        return bitmask<uint32_t, width, 1>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(ctrl::empty), ctrl)));
+    }
+    auto match_free() const {
+        return bitmask<uint32_t, width, 1>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(ctrl::sentinel), ctrl)));
+    }
+};
+#else
+class group {
+protected:
+    static constexpr uint64_t lsbs = 0x0101010101010101;
+    static constexpr uint64_t msbs = 0x8080808080808080;
+    uint64_t ctrl;
+public:
+    static constexpr size_t width = 8;
+    explicit group(const int8_t* p) {
+        std::memcpy(&ctrl, p, sizeof(ctrl));
+        if constexpr (std::endian::native == std::endian::big) ctrl = __builtin_bswap64(ctrl);
+    }
+
+    // may report false positives, which are rejected by the key comparison anyway;
+    auto match(int8_t h2) const {
+        auto x = ctrl ^ (lsbs * static_cast<uint8_t>(h2));
+        return bitmask<uint64_t, width, 8>((x - lsbs) & ~x & msbs);
+    }
+    auto match_empty() const {
+        return bitmask<uint64_t, width, 8>(ctrl & (~ctrl << 6) & msbs);
+    }
+    auto match_free() const {
+        return bitmask<uint64_t, width, 8>(ctrl & (~ctrl << 7) & msbs);
+    }
+};
+#endif
+
+}
\ No newline at end of file
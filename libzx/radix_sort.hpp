@@ -0,0 +1,226 @@
+#pragma once
+#include <bit>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <type_traits>
+#include "slice.hpp"
+#include "string.hpp"
+#include "concepts.hpp"
+#include "algorithm.hpp"
+
+namespace libzx {
+
+// keys that radix_sort takes a byte at a time;
+template<typename T>
+concept radix_key = (integral<T> || std::is_floating_point_v<T>) && sizeof(T) <= 8;
+
+namespace radix {
+
+// below these sizes, sorting by comparison is faster than counting;
+static constexpr size_t lsd_limit = 256, msd_limit = 32;
+
+template<size_t N>
+using unsigned_of = std::conditional_t<N == 1, uint8_t,
+    std::conditional_t<N == 2, uint16_t, std::conditional_t<N == 4, uint32_t, uint64_t>>>;
+
+// maps k to an unsigned integer of its size in the same order: signed integers have their sign bit flipped,
+// and negative floats all of their bits, so that -0.0 comes before 0.0 and NaNs go to the ends by sign;
+template<radix_key K>
+inline auto bits(K k) {
+    using U = unsigned_of<sizeof(K)>;
+    constexpr U sign = U(1) << (sizeof(K) * 8 - 1);
+    if constexpr (std::is_pointer_v<K>) {
+        return static_cast<U>(reinterpret_cast<uintptr_t>(k));
+    } else if constexpr (std::is_floating_point_v<K>) {
+        auto u = std::bit_cast<U>(k);
+        return (u & sign) != 0 ? U(~u) : U(u | sign);
+    } else if constexpr (std::is_signed_v<K>) {
+        return U(static_cast<U>(k) ^ sign);
+    } else {
+        return static_cast<U>(k);
+    }
+}
+
+// lsd sorts by one byte of the key per pass, from the lowest, moving elements between s and a buffer;
+// the counts of every byte are taken in one pass first, so that a byte all keys share costs nothing;
+// it is stable, so records with equal keys keep their order;
+template<typename T, typename F>
+void lsd(slice<T> s, F key) {
+    auto n = s.size();
+    auto digit = [&](T& x, size_t d) { return static_cast<size_t>((bits(key(x)) >> (8 * d)) & 255); };
+    constexpr size_t digits = sizeof(decltype(bits(key(s[0]))));
+    size_t counts[digits][256] = {};
+    for (auto& x : s) {
+        auto u = bits(key(x));
+        for (size_t d = 0; d < digits; d++) counts[d][(u >> (8 * d)) & 255]++;
+    }
+
+    auto buf = std::allocator<T>().allocate(n);
+    // buf holds live elements once anything was moved into it;
+    bool live = false;
+    T *from = s.begin(), *to = buf;
+    for (size_t d = 0; d < digits; d++) {
+        auto& c = counts[d];
+        if (c[digit(*from, d)] == n) continue;
+        for (size_t i = 0, at = 0; i < 256; i++) {
+            auto k = c[i];
+            c[i] = at;
+            at += k;
+        }
+        if (to == buf && !live) {
+            for (auto x = from; x != from + n; x++) std::construct_at(to + c[digit(*x, d)]++, std::move(*x));
+            live = true;
+        } else {
+            for (auto x = from; x != from + n; x++) to[c[digit(*x, d)]++] = std::move(*x);
+        }
+        std::swap(from, to);
+    }
+    if (from == buf) std::move(buf, buf + n, s.begin());
+    if (live) std::destroy(buf, buf + n);
+    std::allocator<T>().deallocate(buf, n);
+}
+
+// sorts the n elements at p by bytes d ... 0 of their keys, leaving them at p if keep, or else at q,
+// and using the other as a buffer; trivially copyable elements only;
+// passes over memory much larger than the cache are slow, since every one of the 256 buckets
+// misses on its own page, so large ranges are first split by their highest byte,
+// and each bucket gets its lower bytes sorted by lsd while it fits in the cache;
+template<typename T, typename F>
+void hybrid(T* p, T* q, size_t n, size_t d, bool keep, F& key) {
+    constexpr size_t cached = (1 << 17) / sizeof(T);
+    auto digit = [&](T& x, size_t d) { return static_cast<size_t>((bits(key(x)) >> (8 * d)) & 255); };
+    if (n <= cached || d == 0) {
+        size_t counts[8][256] = {};
+        for (auto x = p; x != p + n; x++) {
+            auto u = bits(key(*x));
+            for (size_t i = 0; i <= d; i++) counts[i][(u >> (8 * i)) & 255]++;
+        }
+        for (size_t i = 0; i <= d; i++) {
+            auto& c = counts[i];
+            if (n == 0 || c[digit(*p, i)] == n) continue;
+            for (size_t b = 0, at = 0; b < 256; b++) {
+                auto k = c[b];
+                c[b] = at;
+                at += k;
+            }
+            for (auto x = p; x != p + n; x++) q[c[digit(*x, i)]++] = *x;
+            std::swap(p, q);
+            keep = !keep;
+        }
+        if (!keep) std::copy(p, p + n, q);
+        return;
+    }
+    size_t start[257] = {};
+    for (auto x = p; x != p + n; x++) start[digit(*x, d) + 1]++;
+    if (start[digit(*p, d) + 1] == n) return hybrid(p, q, n, d - 1, keep, key);
+    for (size_t b = 0; b < 256; b++) start[b + 1] += start[b];
+    size_t next[256];
+    memcpy(next, start, sizeof(next));
+    for (auto x = p; x != p + n; x++) q[next[digit(*x, d)]++] = *x;
+    for (size_t b = 0; b < 256; b++) {
+        hybrid(q + start[b], p + start[b], start[b + 1] - start[b], d - 1, !keep, key);
+    }
+}
+
+template<typename T, typename F>
+void sort(slice<T> s, F key) {
+    auto n = s.size();
+    if (n < lsd_limit) {
+        return stable_sort(s, [&](T& a, T& b) { return bits(key(a)) < bits(key(b)); });
+    }
+    if constexpr (std::is_trivially_copyable_v<T>) {
+        auto buf = std::allocator<T>().allocate(n);
+        hybrid(s.begin(), buf, n, sizeof(decltype(bits(key(s[0])))) - 1, true, key);
+        std::allocator<T>().deallocate(buf, n);
+    } else {
+        lsd(s, key);
+    }
+}
+
+// msd sorts s, whose elements all have the same size, by their chars from depth on,
+// taking chars as signed if signed_chars, and as unsigned, as memcmp does, otherwise;
+// it moves elements into their buckets in place, and goes on with the largest one;
+template<bool signed_chars, typename T>
+void msd(slice<T> s, size_t depth) {
+    constexpr uint8_t flip = signed_chars ? 0x80 : 0;
+    auto len = s[0].size();
+    auto byte = [&](T& x) { return static_cast<uint8_t>(static_cast<uint8_t>(x.begin()[depth]) ^ flip); };
+    while (depth < len) {
+        if (s.size() < msd_limit) {
+            return libzx::sort(s, [&](T& a, T& b) {
+                if constexpr (signed_chars) {
+                    return elements::compare<signed char>(reinterpret_cast<const signed char*>(a.begin()) + depth,
+                        reinterpret_cast<const signed char*>(b.begin()) + depth, len - depth) < 0;
+                } else {
+                    return memcmp(a.begin() + depth, b.begin() + depth, len - depth) < 0;
+                }
+            });
+        }
+        size_t start[257] = {}, next[256];
+        for (auto& x : s) start[byte(x) + 1]++;
+        if (start[byte(s[0]) + 1] == s.size()) {
+            depth++;
+            continue;
+        }
+        for (size_t i = 0; i < 256; i++) start[i + 1] += start[i];
+        memcpy(next, start, sizeof(next));
+        for (size_t b = 0; b < 256; b++) {
+            while (next[b] < start[b + 1]) {
+                auto k = byte(s[next[b]]);
+                if (k == b) next[b]++;
+                else std::swap(s[next[b]], s[next[k]++]);
+            }
+        }
+        // the largest bucket is sorted by this loop and only the others are recursed into,
+        // each of them holding at most half of s, so the recursion is at most log2(n) deep;
+        size_t big = 0;
+        for (size_t b = 1; b < 256; b++) {
+            if (start[b + 1] - start[b] > start[big + 1] - start[big]) big = b;
+        }
+        for (size_t b = 0; b < 256; b++) {
+            if (b != big && start[b + 1] - start[b] > 1) msd<signed_chars>(s.sub(start[b], start[b + 1]), depth + 1);
+        }
+        s = s.sub(start[big], start[big + 1]);
+        depth++;
+    }
+}
+
+// orders strings as their <=> does, by size first: lsd groups them by size, and msd sorts each group;
+template<bool signed_chars, typename T>
+void strings(slice<T> s) {
+    if (s.size() < 2) return;
+    radix::sort(s, [](T& x) { return x.size(); });
+    for (size_t i = 0, j; i < s.size(); i = j) {
+        for (j = i + 1; j < s.size() && s[j].size() == s[i].size(); j++);
+        if (j - i > 1) msd<signed_chars>(s.sub(i, j), 0);
+    }
+}
+
+}
+
+// sorts integers, pointers and floats by their bytes instead of comparing them;
+template<radix_key T>
+void radix_sort(slice<T> s) {
+    radix::sort(s, [](T& x) { return x; });
+}
+
+// sorts records by the integer or float key returns for each, keeping equal keys in their order;
+template<typename T, typename F>
+requires radix_key<std::remove_cvref_t<std::invoke_result_t<F&, T&>>>
+void radix_sort(slice<T> s, F key) {
+    radix::sort(s, [&](T& x) -> std::remove_cvref_t<std::invoke_result_t<F&, T&>> { return key(x); });
+}
+
+// sorts strings in the order of sort, by size and then by chars;
+// string compares its chars as unsigned, by memcmp, and slice<char> as chars, which may be signed;
+inline void radix_sort(slice<string> s) {
+    radix::strings<false>(s);
+}
+
+inline void radix_sort(slice<slice<char>> s) {
+    radix::strings<std::is_signed_v<char>>(s);
+}
+
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include "slice.hpp"
+#include "smart_array.hpp"
+#if __has_include(<unistd.h>)
+#include <fcntl.h>
+#include <unistd.h>
+#define LIBZX_READ 1
+#endif
+
+namespace libzx {
+
+// reader pulls its input in large blocks and hands out lines or tokens as slices of its buffer,
+// found with memchr, so that nothing is copied or allocated per line;
+// a slice is only valid until the next call, and string(s) keeps a copy of one;
+// a line or token longer than the buffer makes it grow;
+class reader {
+protected:
+    unique_array<char> buffer;
+    // the unread input is [head, tail) of buffer;
+    size_t head = 0, tail = 0;
+    bool done = false;
+    std::istream* in = nullptr;
+    std::unique_ptr<std::ifstream> file;
+#ifdef LIBZX_READ
+    int fd = -1;
+    bool owned = false;
+#endif
+
+    size_t read_some(char* p, size_t n) {
+#ifdef LIBZX_READ
+        if (in == nullptr) {
+            for (;;) {
+                auto r = ::read(fd, p, n);
+                if (r >= 0) return static_cast<size_t>(r);
+                if (errno != EINTR) throw std::runtime_error("reader: cannot read: " + std::string(strerror(errno)));
+            }
+        }
+#endif
+        in->read(p, n);
+        return static_cast<size_t>(in->gcount());
+    }
+
+    // moves the unread input to the front, doubling the buffer if it is full of it, and reads more;
+    bool fill() {
+        if (done) return false;
+        if (head != 0) {
+            memmove(buffer.begin(), buffer.begin() + head, tail - head);
+            tail -= head, head = 0;
+        }
+        if (tail == buffer.size()) {
+            auto b = unique_array<char>(std::max(buffer.size() * 2, (size_t)4096), uninit);
+            memcpy(b.begin(), buffer.begin(), tail);
+            buffer = std::move(b);
+        }
+        auto n = read_some(buffer.begin() + tail, buffer.size() - tail);
+        if (n == 0) done = true;
+        tail += n;
+        return n != 0;
+    }
+
+    auto take(size_t n, size_t skip) {
+        auto p = buffer.begin() + head;
+        head += n + skip;
+        return slice<char>(p, p + n);
+    }
+public:
+    static constexpr size_t block = 1 << 20;
+
+    reader(std::istream& in, size_t block = reader::block) : buffer(block, uninit), in(&in) { }
+
+#ifdef LIBZX_READ
+    reader(int fd, size_t block = reader::block) : buffer(block, uninit), fd(fd) { }
+
+    reader(const char* path, size_t block = reader::block) : buffer(block, uninit), fd(open(path, O_RDONLY)), owned(true) {
+        if (fd < 0) throw std::runtime_error("reader: cannot open " + std::string(path));
+    }
+#else
+    reader(const char* path, size_t block = reader::block) :
+        buffer(block, uninit), file(std::make_unique<std::ifstream>(path, std::ios::binary)) {
+        if (!*file) throw std::runtime_error("reader: cannot open " + std::string(path));
+        in = file.get();
+    }
+#endif
+
+    reader(const reader&) = delete;
+    auto& operator=(const reader&) = delete;
+
+    ~reader() {
+#ifdef LIBZX_READ
+        if (owned) close(fd);
+#endif
+    }
+
+    // the next line without its delimiter; the last one may have none;
+    std::optional<slice<char>> line(char delim = '\n') {
+        for (size_t seen = 0;;) {
+            auto p = buffer.begin() + head;
+            if (auto q = static_cast<char*>(memchr(p + seen, delim, tail - head - seen)); q != nullptr) {
+                return take(q - p, 1);
+            }
+            seen = tail - head;
+            if (!fill()) {
+                if (head == tail) return std::nullopt;
+                return take(tail - head, 0);
+            }
+        }
+    }
+
+    // the next run of chars that are not white space;
+    std::optional<slice<char>> token() {
+        for (;;) {
+            while (head < tail && isspace(static_cast<unsigned char>(buffer[head]))) head++;
+            if (head < tail || !fill()) break;
+        }
+        if (head == tail) return std::nullopt;
+        for (size_t n = 0;;) {
+            while (head + n < tail && !isspace(static_cast<unsigned char>(buffer[head + n]))) n++;
+            if (head + n < tail) return take(n, 1);
+            if (!fill()) return take(n, 0);
+        }
+    }
+
+    struct iter {
+        reader* const r;
+        std::optional<slice<char>> current;
+        auto& operator++() { current = r->line(); return *this; }
+        auto operator!=(iter&) { return current.has_value(); }
+        auto& operator*() { return *current; }
+    };
+
+    // iterates over lines;
+    auto begin() { return iter{ this, line() }; }
+    auto end() { return iter{ this, std::nullopt }; }
+};
+
+}
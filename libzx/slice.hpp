@@ -1,10 +1,45 @@
 #pragma once
 #include <string>
+#include <cstring>
+#include <compare>
+#include <cstdint>
 #include <stdexcept>
+#include "kernels.hpp"
 #include "concepts.hpp"
 
 namespace libzx {
 
+// comparisons of n elements at a and b, for slices and arrays;
+// elements that compare by their bytes are compared by memcmp, or found to differ a vector at a time;
+namespace elements {
+    template<typename T>
+    auto compare(const T* a, const T* b, size_t n) {
+        using R = std::compare_three_way_result_t<T>;
+        if constexpr (bitwise_comparable<T>) {
+            if (n == 0) return R(std::strong_ordering::equal);
+            if constexpr (sizeof(T) == 1 && std::is_unsigned_v<T>) return R(memcmp(a, b, n) <=> 0);
+            auto i = kernels::dispatch<kernels::mismatch>(reinterpret_cast<const uint8_t*>(a),
+                reinterpret_cast<const uint8_t*>(b), n * sizeof(T)) / sizeof(T);
+            return i == n ? R(std::strong_ordering::equal) : R(a[i] <=> b[i]);
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                if (a[i] != b[i]) return R(a[i] <=> b[i]);
+            }
+            return R(std::strong_ordering::equal);
+        }
+    }
+
+    template<typename T>
+    bool equal(const T* a, const T* b, size_t n) {
+        if constexpr (bitwise_comparable<T>) {
+            return n == 0 || memcmp(a, b, n * sizeof(T)) == 0;
+        } else {
+            for (size_t i = 0; i < n; i++) if (!(a[i] == b[i])) return false;
+            return true;
+        }
+    }
+}
+
 // slice is a reference to a continuous space;
 // it is undefined to refer to discontinuous spaces;
 // it is totally safe, except when vector grows;
@@ -42,17 +77,13 @@ public:
     }
 
     auto operator<=>(const slice& s) const {
-        if (len != s.len) return len <=> s.len;
-        for (size_t i = 0; i < len-1; i++) {
-            if (data[i] != s.data[i]) {
-                return data[i] <=> s.data[i];
-            }
-        }
-        return data[len-1] <=> s.data[len-1];
+        using R = std::compare_three_way_result_t<T>;
+        if (len != s.len) return R(len <=> s.len);
+        return elements::compare<std::remove_cv_t<T>>(data, s.data, len);
     }
 
     auto operator==(const slice& s) const {
-        return (*this <=> s) == 0;
+        return len == s.len && elements::equal<std::remove_cv_t<T>>(data, s.data, len);
     }
 
     size_t size() const noexcept { return len; }
@@ -63,19 +94,14 @@ public:
 };
 
 template<size_t N>
-inline auto operator<=>(slice<char>& s1, const char (&s2)[N]) {
+inline auto operator<=>(const slice<char>& s1, const char (&s2)[N]) {
     if (s1.size() != N-1) return s1.size() <=> N-1;
-    for (size_t i = 0; i < N-2; i++) {
-        if (s1[i] != s2[i]) {
-            return s1[i] <=> s2[i];
-        }
-    }
-    return s1.back() <=> s2[N-2];
+    return elements::compare<char>(s1.begin(), s2, N-1);
 }
 
 template<size_t N>
-inline auto operator==(slice<char>& s1, const char (&s2)[N]) {
-    return (s1 <=> s2) == 0;
+inline auto operator==(const slice<char>& s1, const char (&s2)[N]) {
+    return s1.size() == N-1 && elements::equal<char>(s1.begin(), s2, N-1);
 }
 
 }
@@ -0,0 +1,139 @@
+#pragma once
+#include "vector.hpp"
+
+namespace libzx {
+
+// small_vector keeps up to N elements inside the object and moves them to the heap only past that;
+// once on the heap it grows as a vector does, and only shrink_to_fit brings it back;
+template<typename T, size_t N>
+requires (N > 0)
+class small_vector : protected vector<T> {
+protected:
+    using base = vector<T>;
+    using base::data, base::len, base::space, base::allocate, base::deallocate;
+    alignas(T) unsigned char buffer[N * sizeof(T)];
+
+    T* local() noexcept { return reinterpret_cast<T*>(buffer); }
+    bool is_local() noexcept { return data == local(); }
+
+    // moves the live elements into p, which holds new_cap slots, and adopts it;
+    // the inline buffer is never handed to the allocator;
+    void adopt(T* p, size_t new_cap) {
+        relocate(data, len, p);
+        if (!is_local()) deallocate(data, space);
+        data = p, space = new_cap;
+    }
+
+    // takes the elements of v, which is left empty and inline; this must be empty and inline too;
+    void take(small_vector& v) {
+        if (v.is_local()) {
+            relocate(v.data, v.len, data);
+        } else {
+            data = v.data, space = v.space;
+            v.data = v.local(), v.space = N;
+        }
+        len = v.len;
+        v.len = 0;
+    }
+public:
+    small_vector() noexcept : base(reinterpret_cast<T*>(buffer), N, uninit) { }
+    small_vector(size_t len) : small_vector() { resize(len); }
+    small_vector(std::initializer_list<T> l) : small_vector() {
+        reserve(l.size());
+        std::uninitialized_copy(l.begin(), l.end(), data);
+        len = l.size();
+    }
+    small_vector(const slice<T>& s) : small_vector() {
+        reserve(s.size());
+        std::uninitialized_copy(s.begin(), s.end(), data);
+        len = s.size();
+    }
+    small_vector(const small_vector& v) : small_vector() {
+        reserve(v.len);
+        std::uninitialized_copy(v.begin(), v.end(), data);
+        len = v.len;
+    }
+    small_vector(small_vector&& v) : small_vector() { take(v); }
+
+    // the base destructor then finds nothing left to destroy or free;
+    ~small_vector() {
+        std::destroy(data, data + len);
+        if (!is_local()) deallocate(data, space);
+        data = nullptr, len = space = 0;
+    }
+
+    auto& operator=(const small_vector& v) {
+        if (this != &v) {
+            base::clear();
+            reserve(v.len);
+            std::uninitialized_copy(v.begin(), v.end(), data);
+            len = v.len;
+        }
+        return *this;
+    }
+
+    auto& operator=(small_vector&& v) noexcept {
+        if (this != &v) {
+            base::clear();
+            if (!is_local()) deallocate(data, space), data = local(), space = N;
+            take(v);
+        }
+        return *this;
+    }
+
+    auto& push_back(convertible_to<T> auto&& t) {
+        return emplace_back(std::forward<decltype(t)>(t));
+    }
+
+    // as in vector, the element is built before the old storage is released;
+    auto& emplace_back(auto&&... a) {
+        if (len == space) {
+            auto new_cap = std::bit_ceil(space + 2);
+            auto p = allocate(new_cap);
+            std::construct_at(p + len, std::forward<decltype(a)>(a)...);
+            adopt(p, new_cap);
+        } else {
+            std::construct_at(data + len, std::forward<decltype(a)>(a)...);
+        }
+        len++;
+        return *this;
+    }
+
+    auto& reserve(size_t n) {
+        if (n > space) adopt(allocate(n), n);
+        return *this;
+    }
+
+    // grows through this class's reserve, so that the inline buffer is never freed;
+    auto& resize(size_t n) {
+        reserve(n);
+        base::template resize_within<true>(n);
+        return *this;
+    }
+
+    auto& resize(size_t n, uninit_t) {
+        reserve(n);
+        base::template resize_within<false>(n);
+        return *this;
+    }
+
+    // moves back inline if the elements fit there;
+    auto& shrink_to_fit() {
+        if (is_local() || space == len) return *this;
+        auto p = data, n = space;
+        if (len <= N) {
+            relocate(p, len, local());
+            data = local(), space = N;
+        } else {
+            data = allocate(len), space = len;
+            relocate(p, len, data);
+        }
+        deallocate(p, n);
+        return *this;
+    }
+
+    using base::pop_back, base::clear, base::operator[], base::at;
+    using base::size, base::capacity, base::front, base::back, base::begin, base::end;
+};
+
+}
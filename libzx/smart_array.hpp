@@ -8,6 +8,39 @@
 
 namespace libzx {
 
+// asks for default-initialized elements, which leaves trivial types untouched;
+// class types are still default constructed, since arrays destroy every element they hold;
+// vector is the container that keeps raw capacity and constructs only the elements it uses;
+struct uninit_t { explicit uninit_t() = default; };
+inline constexpr uninit_t uninit{};
+
+// moves n live objects from from into raw memory at to, leaving raw memory behind;
+template<typename T, bool bytes = trivially_relocatable<T>>
+void relocate(T* from, size_t n, T* to) {
+    if constexpr (bytes) {
+        if (n != 0) memcpy((void*)to, (const void*)from, n * sizeof(T));
+    } else {
+        std::uninitialized_move(from, from + n, to);
+        std::destroy(from, from + n);
+    }
+}
+
+// moves n live objects from from onto live objects at to;
+// relocatable objects trade bytes instead, so what was at to is left at from to be destroyed there;
+template<typename T, bool bytes = trivially_relocatable<T>>
+void relocate_over(T* from, size_t n, T* to) {
+    if constexpr (bytes && !std::is_trivially_copyable_v<T>) {
+        for (size_t i = 0; i < n; i++) {
+            alignas(T) unsigned char t[sizeof(T)];
+            memcpy(t, (const void*)(to + i), sizeof(T));
+            memcpy((void*)(to + i), (const void*)(from + i), sizeof(T));
+            memcpy((void*)(from + i), t, sizeof(T));
+        }
+    } else {
+        std::move(from, from + n, to);
+    }
+}
+
 template<typename T>
 class unique_array : public std::unique_ptr<T[]> {
 protected:
@@ -16,6 +49,8 @@ protected:
 public:
     unique_array() = default;
     unique_array(size_t size) : data(new T[size]()), len(size) { }
+    // skips zeroing trivial elements; others are default constructed as usual;
+    unique_array(size_t size, uninit_t) : data(new T[size]), len(size) { }
     unique_array(unique_array&& a) : data(a.release()), len(a.len) { a.len = 0; }
     unique_array(std::initializer_list<T> l) : data(new T[l.size()]()), len(l.size()) {
         std::move(l.begin(), l.end(), data::get());
@@ -54,6 +89,9 @@ public:
     T* end() const noexcept { return data::get() + len; }
 };
 
+template<typename T>
+struct is_trivially_relocatable<unique_array<T>> : std::true_type {};
+
 template<typename T>
 class shared_array : public std::shared_ptr<T[]> {
 protected:
@@ -90,4 +128,4 @@ public:
     T* end() const noexcept { return data::get() + len; }
 };
 
-}
+}
\ No newline at end of file
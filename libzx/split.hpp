@@ -0,0 +1,181 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include "slice.hpp"
+#if defined(__AVX2__) && !defined(LIBZX_NO_SIMD)
+#include <immintrin.h>
+#define LIBZX_AVX2 1
+#elif (defined(__SSE2__) || defined(_M_X64)) && !defined(LIBZX_NO_SIMD)
+#include <emmintrin.h>
+#define LIBZX_SSE2 1
+#endif
+
+namespace libzx {
+
+// char_set finds its chars in 64 bytes at once, reporting them as the bits of a mask;
+// up to 16 chars are compared with SSE2 or AVX2 where available, and larger sets use a table;
+class char_set {
+protected:
+    static constexpr size_t max_simd = 16;
+    char chars[max_simd];
+    size_t n = 0;
+    uint64_t table[4] = {};
+
+    uint64_t match_table(const char* p) const {
+        uint64_t m = 0;
+        for (size_t i = 0; i < 64; i++) {
+            auto c = static_cast<uint8_t>(p[i]);
+            m |= ((table[c >> 6] >> (c & 63)) & 1) << i;
+        }
+        return m;
+    }
+public:
+    char_set(const char* s) {
+        for (; *s != 0; s++) {
+            auto c = static_cast<uint8_t>(*s);
+            if ((table[c >> 6] >> (c & 63)) & 1) continue;
+            table[c >> 6] |= uint64_t(1) << (c & 63);
+            if (n < max_simd) chars[n] = *s;
+            n++;
+        }
+    }
+
+    uint64_t match(const char* p) const {
+#if defined(LIBZX_AVX2)
+        if (n <= max_simd) {
+            auto lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            auto hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+            auto ml = _mm256_setzero_si256(), mh = _mm256_setzero_si256();
+            for (size_t i = 0; i < n; i++) {
+                auto c = _mm256_set1_epi8(chars[i]);
+                ml = _mm256_or_si256(ml, _mm256_cmpeq_epi8(lo, c));
+                mh = _mm256_or_si256(mh, _mm256_cmpeq_epi8(hi, c));
+            }
+            return static_cast<uint32_t>(_mm256_movemask_epi8(ml)) |
+                static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(mh))) << 32;
+        }
+#elif defined(LIBZX_SSE2)
+        if (n <= max_simd) {
+            uint64_t m = 0;
+            for (size_t k = 0; k < 64; k += 16) {
+                auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + k));
+                auto r = _mm_setzero_si128();
+                for (size_t i = 0; i < n; i++) r = _mm_or_si128(r, _mm_cmpeq_epi8(v, _mm_set1_epi8(chars[i])));
+                m |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(r))) << k;
+            }
+            return m;
+        }
+#endif
+        return match_table(p);
+    }
+};
+
+enum class split_mode { fields, tokens, csv };
+
+// split_view walks the fields of a slice between delimiters, lazily, without allocating;
+// fields are slices of the input, so they live as long as it does;
+// in csv mode, delimiters between double quotes are not split on, and a quoted field
+// is returned without its outer quotes; doubled quotes inside it are left as they are;
+class split_view {
+protected:
+    slice<char> s;
+    char_set delims, quotes;
+    split_mode mode;
+public:
+    split_view(slice<char> s, const char* delims, split_mode mode = split_mode::fields) :
+        s(s), delims(delims), quotes("\""), mode(mode) {}
+
+    struct iter {
+        const split_view* v;
+        const char *block, *start;
+        // delimiters left in the current block, and whether the block ends inside quotes;
+        uint64_t bits = 0, quoted = 0;
+        slice<char> field;
+        bool last = false, done = false;
+
+        // matches the block at block, padding the last one with zeros;
+        void scan() {
+            auto end = v->s.end();
+            auto left = static_cast<size_t>(end - block);
+            const char* p = block;
+            char pad[64];
+            if (left < 64) {
+                memset(pad, 0, sizeof(pad));
+                if (left != 0) memcpy(pad, block, left);
+                p = pad;
+            }
+            bits = v->delims.match(p);
+            if (v->mode == split_mode::csv) {
+                // a prefix xor of the quote bits marks every byte after an odd number of quotes;
+                auto q = v->quotes.match(p);
+                q ^= q << 1, q ^= q << 2, q ^= q << 4, q ^= q << 8, q ^= q << 16, q ^= q << 32;
+                q ^= quoted;
+                bits &= ~q;
+                quoted = static_cast<uint64_t>(static_cast<int64_t>(q) >> 63);
+            }
+            if (left < 64) bits &= (uint64_t(1) << left) - 1;
+        }
+
+        auto take(const char* stop) {
+            auto b = const_cast<char*>(start), e = const_cast<char*>(stop);
+            if (v->mode == split_mode::csv && e - b >= 2 && *b == '"' && e[-1] == '"') b++, e--;
+            field = slice<char>(b, e);
+        }
+
+        // tokens mode goes on past empty fields;
+        void next() {
+            while (!done) {
+                if (bits != 0) {
+                    auto d = block + std::countr_zero(bits);
+                    bits &= bits - 1;
+                    take(d);
+                    start = d + 1;
+                } else if (v->s.end() - block > 64) {
+                    block += 64;
+                    scan();
+                    continue;
+                } else if (!last) {
+                    // the last field runs to the end, after the last delimiter;
+                    take(v->s.end());
+                    last = true;
+                } else {
+                    done = true;
+                    return;
+                }
+                if (v->mode != split_mode::tokens || field.size() != 0) return;
+            }
+        }
+
+        auto& operator++() { next(); return *this; }
+        auto operator!=(iter&) { return !done; }
+        auto& operator*() { return field; }
+    };
+
+    auto begin() const {
+        auto i = iter{ this, s.begin(), s.begin(), 0, 0, {}, false, false };
+        i.scan();
+        i.next();
+        return i;
+    }
+    auto end() const {
+        return iter{ this, nullptr, nullptr, 0, 0, {}, true, true };
+    }
+};
+
+// every field between delimiters, including empty ones;
+inline auto split(slice<char> s, const char* delims = ",") {
+    return split_view(s, delims, split_mode::fields);
+}
+
+// the non-empty runs of chars between delimiters;
+inline auto tokens(slice<char> s, const char* delims = " \t\r\n") {
+    return split_view(s, delims, split_mode::tokens);
+}
+
+// the fields of one csv record, which may have delimiters and line breaks inside quotes;
+inline auto split_csv(slice<char> s, const char* delims = ",") {
+    return split_view(s, delims, split_mode::csv);
+}
+
+}
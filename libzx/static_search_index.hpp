@@ -0,0 +1,95 @@
+#pragma once
+#include <bit>
+#include <numeric>
+#include <cstdint>
+#include <stdexcept>
+#include "slice.hpp"
+#include "probe.hpp"
+#include "concepts.hpp"
+#include "smart_array.hpp"
+
+namespace libzx {
+
+// static_search_index holds a sorted set of keys in Eytzinger order, the order of a breadth-first walk
+// of the balanced search tree over them: the children of tree[k] are tree[2k] and tree[2k + 1];
+// the first levels of the tree share a few cache lines, and the descendants of tree[k] some levels
+// below it are next to each other, so that a search prefetches them a cache line at a time
+// while it compares its way down, instead of missing the cache once per level as binary search does;
+// the keys cannot change once the index is built;
+template<comparable T>
+class static_search_index {
+protected:
+    static constexpr size_t line = 64;
+    // the descendants of tree[k] some levels below it, at tree[k * block] on, which fill at most a cache line,
+    // and exactly one, starting on its boundary, when sizeof(T) divides it;
+    static constexpr size_t block = sizeof(T) < line ? std::bit_floor(line / sizeof(T)) : 1;
+    // the keys from the start of the array within which one lies on a cache line boundary, if any does;
+    static constexpr size_t pad = line / std::gcd(sizeof(T), line);
+
+    unique_array<T> keys;
+    // tree[1] ... tree[len], in keys, with tree[0] on a cache line boundary;
+    T* tree = nullptr;
+    size_t len = 0;
+
+    // puts the keys of s, in order, at the nodes of the subtree under k;
+    void fill(slice<T> s, size_t& i, size_t k) {
+        if (k > len) return;
+        fill(s, i, 2 * k);
+        tree[k] = s[i++];
+        fill(s, i, 2 * k + 1);
+    }
+
+    // walks down from the root, going right past the keys that below is true of;
+    // the nodes of the path are the bits of k, so the last node it went left at
+    // is found by dropping the ones it went right at and one more;
+    const T* descend(auto&& below) const {
+        size_t k = 1;
+        while (k <= len) {
+            // the address is only a hint, and may lie past the end of the tree;
+            if constexpr (block > 1) {
+                prefetch(reinterpret_cast<const void*>(reinterpret_cast<uintptr_t>(tree) + k * block * sizeof(T)));
+            }
+            bool right = below(tree[k]);
+            k = 2 * k + right;
+        }
+        k >>= std::countr_one(k) + 1;
+        return k == 0 ? nullptr : tree + k;
+    }
+public:
+    static_search_index() = default;
+
+    // copies the keys of sorted, which must be in ascending order;
+    static_search_index(slice<T> sorted) : keys(sorted.size() + pad + 1), len(sorted.size()) {
+        for (size_t i = 1; i < len; i++) {
+            if (sorted[i] < sorted[i - 1]) throw std::invalid_argument("static_search_index: keys are not sorted");
+        }
+        tree = keys.begin();
+        for (size_t j = 0; j < pad; j++) {
+            if (reinterpret_cast<uintptr_t>(keys.begin() + j) % line == 0) {
+                tree = keys.begin() + j;
+                break;
+            }
+        }
+        size_t i = 0;
+        fill(sorted, i, 1);
+    }
+
+    // the least key not less than key, or nullptr;
+    const T* lower_bound(const T& key) const {
+        return descend([&](const T& x) { return x < key; });
+    }
+
+    // the least key greater than key, or nullptr;
+    const T* upper_bound(const T& key) const {
+        return descend([&](const T& x) { return !(key < x); });
+    }
+
+    bool contains(const T& key) const {
+        auto p = lower_bound(key);
+        return p != nullptr && !(key < *p);
+    }
+
+    size_t size() const noexcept { return len; }
+};
+
+}
@@ -1,99 +1,228 @@
 #pragma once
 #include "vector.hpp"
+#include <bit>
+#include <limits>
 #include <cstring>
+#include <charconv>
+#include <optional>
 #include <iostream>
 
 namespace libzx {
 
-class string : public vector<char> {
+// a short string keeps up to 23 chars in the object itself, and its last byte holds 23 - size,
+// which is also the terminating 0 of a full one; a long string points to the heap instead,
+// and the last byte, the top of its capacity, has its high bit set;
+// every operation is driven by the stored length, so embedded 0 chars are kept;
+class string {
+protected:
+    static constexpr size_t local = 23;
+    static constexpr bool little = std::endian::native == std::endian::little;
+    static constexpr size_t mark = little ? size_t(1) << 63 : 0x80;
+
+    union {
+        struct { char* ptr; size_t len; size_t cap; } heap;
+        char buf[local + 1];
+    };
+
+    bool is_long() const noexcept { return static_cast<unsigned char>(buf[local]) & 0x80; }
+    size_t heap_cap() const noexcept { return little ? heap.cap & ~mark : heap.cap >> 8; }
+
+    void set_size(size_t n) noexcept {
+        if (is_long()) heap.len = n;
+        else buf[local] = static_cast<char>(local - n);
+        begin()[n] = 0;
+    }
+
+    // takes p, which has room for cap chars and the terminating 0, as the storage of size chars;
+    void adopt(char* p, size_t size, size_t cap) noexcept {
+        if (is_long()) delete[] heap.ptr;
+        heap.ptr = p, heap.len = size;
+        heap.cap = little ? cap | mark : cap << 8 | mark;
+    }
+
+    void init(const char* s, size_t n) {
+        buf[local] = static_cast<char>(local);
+        if (n > local) adopt(new char[std::bit_ceil(n + 1)], n, std::bit_ceil(n + 1) - 1);
+        memcpy(begin(), s, n);
+        set_size(n);
+    }
+
+    // moves to the heap with room for at least n chars;
+    void grow(size_t n) {
+        auto cap = std::bit_ceil(n + 1);
+        auto p = new char[cap];
+        memcpy(p, begin(), size() + 1);
+        adopt(p, size(), cap - 1);
+    }
+
+    void steal(string& s) noexcept {
+        memcpy(buf, s.buf, sizeof(buf));
+        s.buf[local] = static_cast<char>(local);
+        s.buf[0] = 0;
+    }
 public:
-    string() :                     vector()  { }
-    string(char c) :               vector{c} { }
-    string(const char* s) :        vector(strlen(s), true) { strcpy(begin(), s); }
-    string(const string& s) :      vector(s)  { }
-    string(string&& s) :           vector(s)  { }
+    string() noexcept :            buf{} { buf[local] = static_cast<char>(local); }
+    string(char c) :               string() { push_back(c); }
+    string(const char* s) :        string() { init(s, strlen(s)); }
+    string(const string& s) :      string() { init(s.begin(), s.size()); }
+    string(string&& s) noexcept :  string() { steal(s); }
     template<size_t N>
-    string(const char (&s)[N]) :   vector(N-1, true) { strcpy(begin(), s); }
-    string(const slice<char>& s) : vector(s.size(), true)  { strncpy(begin(), s.begin(), s.size()); }
+    string(const char (&s)[N]) :   string() { init(s, N-1); }
+    string(const slice<char>& s) : string() { init(s.begin(), s.size()); }
+
+    ~string() { if (is_long()) delete[] heap.ptr; }
 
     auto& operator=(const string& s) {
-        return vector::operator=(s);
+        if (this != &s) clear().append(s.begin(), s.size());
+        return *this;
     }
     auto& operator=(string&& s) noexcept {
-        return vector::operator=(std::move(s));
+        if (this != &s) {
+            if (is_long()) delete[] heap.ptr;
+            steal(s);
+        }
+        return *this;
     }
 
-    auto& push_back(char c) {
-        vector::push_back(c);
-        *end() = 0;
+    // grows geometrically, so that repeated appends copy each char a constant number of times;
+    string& append(const char* s, size_t n) {
+        auto size = this->size();
+        if (size + n > capacity()) {
+            auto cap = std::bit_ceil(size + n + 1);
+            auto p = new char[cap];
+            memcpy(p, begin(), size);
+            memcpy(p + size, s, n);
+            adopt(p, size, cap - 1);
+        } else {
+            memcpy(begin() + size, s, n);
+        }
+        set_size(size + n);
         return *this;
     }
 
-    auto pop_back() {
-        auto r = vector::pop_back();
-        *end() = 0;
-        return r;
+    // formats v in place, in the shortest form that reads back the same, growing at most once;
+    template<typename T>
+    requires std::is_arithmetic_v<T> && (!std::same_as<T, char>) && (!std::same_as<T, bool>)
+    string& append(T v) {
+        constexpr size_t most = std::is_integral_v<T> ? std::numeric_limits<T>::digits10 + 3 : 32;
+        auto size = this->size();
+        auto p = reserve(size + most).begin();
+        auto r = std::to_chars(p + size, p + size + most, v);
+        set_size(r.ptr - p);
+        return *this;
     }
 
-    auto& operator+=(const string& s) { 
-        if (cap() - len <= s.size()) grow(s.size());
-        strcpy(end(), s.begin());
-        len += s.size();
+    string& append(char c) { return append(&c, 1); }
+
+    string& push_back(char c) { return append(&c, 1); }
+
+    char pop_back() {
+        if (size() == 0) at(0);
+        auto c = back();
+        set_size(size() - 1);
+        return c;
+    }
+
+    // capacities count chars; the slot of the terminating 0 always comes on top;
+    auto& reserve(size_t n) {
+        if (n > capacity()) grow(n);
         return *this;
     }
 
-    template<size_t N>
-    auto& operator+=(const char (&s)[N]) {
-        if (cap() - len <= N-1) grow(N-1);
-        strcpy(end(), s);
-        len += N-1;
+    // new chars are 0;
+    auto& resize(size_t n) {
+        auto size = this->size();
+        if (n > size) memset(reserve(n).begin() + size, 0, n - size);
+        set_size(n);
+        return *this;
+    }
+
+    // new chars are left as they are;
+    auto& resize(size_t n, uninit_t) {
+        reserve(n).set_size(n);
         return *this;
     }
 
-    auto& operator+=(char* s) {
-        size_t s_len = strlen(s);
-        if (cap() - len <= s_len) grow(s_len);
-        strcpy(end(), s);
-        len += s_len;
+    // moves back into the object if the chars fit there;
+    auto& shrink_to_fit() {
+        if (!is_long() || heap.len == heap_cap()) return *this;
+        auto p = heap.ptr;
+        auto n = heap.len;
+        if (n <= local) {
+            memcpy(buf, p, n);
+            buf[local] = static_cast<char>(local - n);
+            buf[n] = 0;
+            delete[] p;
+        } else {
+            auto q = new char[n + 1];
+            memcpy(q, p, n + 1);
+            adopt(q, n, n);
+        }
         return *this;
     }
 
-    auto& operator+=(const slice<char>& s) {
-        if (cap() - len <= s.size()) grow(s.size());
-        strncpy(end(), s.begin(), s.size());
-        len += s.size();
+    string& clear() noexcept {
+        set_size(0);
         return *this;
     }
 
+    auto& operator+=(const string& s) { return append(s.begin(), s.size()); }
+
+    template<size_t N>
+    auto& operator+=(const char (&s)[N]) { return append(s, N-1); }
+
+    auto& operator+=(char* s) { return append(s, strlen(s)); }
+
+    auto& operator+=(const slice<char>& s) { return append(s.begin(), s.size()); }
+
     auto& operator+=(char c) { return push_back(c); }
 
     auto operator<=>(const string& s) const noexcept {
-        if (len != s.len) return len <=> s.len;
-        return strcmp(begin(), s.begin()) <=> 0;
+        if (size() != s.size()) return size() <=> s.size();
+        return memcmp(begin(), s.begin(), size()) <=> 0;
     }
 
     auto operator<=>(const slice<char>& s) const noexcept {
-        if (len != s.size()) return len <=> s.size();
-        return strcmp(begin(), s.begin()) <=> 0;
+        if (size() != s.size()) return size() <=> s.size();
+        return memcmp(begin(), s.begin(), size()) <=> 0;
     }
 
     template<size_t N>
     auto operator<=>(const char (&s)[N]) const noexcept {
-        if (len != N-1) return len <=> N-1;
-        return strcmp(begin(), s) <=> 0;
+        if (size() != N-1) return size() <=> N-1;
+        return memcmp(begin(), s, N-1) <=> 0;
     }
 
     auto operator<=>(const char* s) const noexcept {
-        return strcmp(begin(), s) <=> 0;
+        auto n = strlen(s);
+        if (size() != n) return size() <=> n;
+        return memcmp(begin(), s, n) <=> 0;
     }
 
-    auto operator==(comparable_with<string> auto&& s) {
+    auto operator==(comparable_with<string> auto&& s) const {
         return (*this <=> s) == 0;
     }
 
-    const char* c_str() const noexcept { return data.get(); }
+    char& operator[](size_t i) noexcept { return begin()[i]; }
+
+    char& at(size_t i) {
+        if (i >= size())
+            throw std::out_of_range("string: index (which is " + std::to_string(i) +
+                 ") >= this->size() (which is " + std::to_string(size()) + ")");
+        else
+            return begin()[i];
+    }
+
+    size_t size() const noexcept { return is_long() ? heap.len : local - buf[local]; }
+    size_t capacity() const noexcept { return is_long() ? heap_cap() : local; }
+    char& front() { return begin()[0]; }
+    char& back() { return begin()[size()-1]; }
+    char* begin() const noexcept { return is_long() ? heap.ptr : const_cast<char*>(buf); }
+    char* end() const noexcept { return begin() + size(); }
+
+    const char* c_str() const noexcept { return begin(); }
 
-    auto std_str() const noexcept { return std::string(data.get()); }
+    auto std_str() const noexcept { return std::string(begin(), size()); }
 
     static auto getline(std::istream& in = std::cin) {
         string s;
@@ -108,13 +237,40 @@ public:
     friend auto& operator>>(std::istream& in, string& s);
 };
 
+template<>
+struct is_trivially_relocatable<string> : std::true_type {};
+
 inline auto operator+(convertible_to<string> auto&& s1, joinable_to<string> auto&& s2) {
     string s(std::forward<decltype(s1)>(s1));
     return std::move(s += s2);
 }
 
+// reads all of s as a T, without copying it; it throws as std::stoi does,
+// std::invalid_argument if s is not a T and std::out_of_range if it does not fit in one;
+template<typename T>
+requires std::is_arithmetic_v<T> && (!std::same_as<T, bool>)
+T parse(const slice<char>& s) {
+    T v;
+    auto [p, e] = std::from_chars(s.begin(), s.end(), v);
+    if (e == std::errc::result_out_of_range)
+        throw std::out_of_range("parse: " + std::string(s.begin(), s.size()) + " is out of range");
+    if (e != std::errc() || p != s.end())
+        throw std::invalid_argument("parse: " + std::string(s.begin(), s.size()) + " is not a number");
+    return v;
+}
+
+// as parse, but reports an error as an empty result;
+template<typename T>
+requires std::is_arithmetic_v<T> && (!std::same_as<T, bool>)
+std::optional<T> try_parse(const slice<char>& s) {
+    T v;
+    auto [p, e] = std::from_chars(s.begin(), s.end(), v);
+    if (e != std::errc() || p != s.end()) return std::nullopt;
+    return v;
+}
+
 inline auto& operator<<(std::ostream& out, const string& s) {
-    return out << s.c_str();
+    return out.write(s.begin(), s.size());
 }
 
 inline auto& operator<<(std::ostream& out, const slice<char>& s) {
@@ -123,7 +279,7 @@ inline auto& operator<<(std::ostream& out, const slice<char>& s) {
 }
 
 inline auto& operator>>(std::istream& in, string& s) {
-    s[0] = 0; s.len = 0;
+    s.clear();
     while (isspace(in.peek())) in.get();
     for (; !isspace(in.peek()) && in.peek() != EOF; in.get()) {
         s.push_back(in.peek());
@@ -132,7 +288,7 @@ inline auto& operator>>(std::istream& in, string& s) {
 }
 
 inline auto& getline(std::istream& in, string& s) {
-    s[0] = 0; s.len = 0;
+    s.clear();
     for (; in.peek() != '\n' && in.peek() != EOF; in.get()) {
         s.push_back(in.peek());
     }
@@ -0,0 +1,158 @@
+#pragma once
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include "string.hpp"
+#include "vector.hpp"
+#include "smart_array.hpp"
+#if __has_include(<sys/uio.h>)
+#include <unistd.h>
+#include <sys/uio.h>
+#define LIBZX_WRITEV 1
+#endif
+
+namespace libzx {
+
+// string_builder appends into a list of chunks, each twice as large as the one before up to a limit,
+// so that growing never copies what was already appended;
+// build() copies everything once into a string of the exact size, and write() needs no string at all;
+class string_builder {
+protected:
+    struct chunk {
+        unique_array<char> data;
+        size_t used = 0;
+    };
+
+    static constexpr size_t first_chunk = 256, max_chunk = 1 << 20;
+
+    vector<chunk> chunks;
+    // the chunk being appended to; those after it are empty, kept from before a clear();
+    size_t current = 0;
+    size_t len = 0;
+
+    // moves to the next chunk, reusing it if it has room for n chars, or else allocating one;
+    void next(size_t n) {
+        if (chunks.size() != 0 && chunks[current].used != 0) current++;
+        while (current < chunks.size() && chunks[current].data.size() < n) current++;
+        if (current == chunks.size()) {
+            auto size = chunks.size() == 0 ? first_chunk :
+                std::min(chunks.back().data.size() * 2, max_chunk);
+            chunks.push_back(chunk{ unique_array<char>(std::max(size, std::bit_ceil(n)), uninit) });
+        }
+        chunks[current].used = 0;
+    }
+public:
+    string_builder() = default;
+    // room for n chars is allocated up front, in one chunk;
+    string_builder(size_t n) { next(n); }
+
+    string_builder& append(const char* s, size_t n) {
+        if (chunks.size() != 0) {
+            auto& c = chunks[current];
+            auto k = std::min(n, c.data.size() - c.used);
+            memcpy(c.data.begin() + c.used, s, k);
+            c.used += k, len += k, s += k, n -= k;
+        }
+        if (n != 0) {
+            next(n);
+            memcpy(chunks[current].data.begin(), s, n);
+            chunks[current].used = n, len += n;
+        }
+        return *this;
+    }
+
+    // formats v as string::append does, straight into the current chunk when it has room
+    // for the longest result, and through a buffer on the stack otherwise;
+    template<typename T>
+    requires std::is_arithmetic_v<T> && (!std::same_as<T, char>) && (!std::same_as<T, bool>)
+    string_builder& append(T v) {
+        constexpr size_t longest = 32;
+        if (chunks.size() != 0 && chunks[current].data.size() - chunks[current].used >= longest) {
+            auto& c = chunks[current];
+            auto p = c.data.begin() + c.used;
+            auto r = std::to_chars(p, p + longest, v);
+            c.used += r.ptr - p, len += r.ptr - p;
+            return *this;
+        }
+        char t[longest];
+        auto r = std::to_chars(t, t + sizeof(t), v);
+        return append(t, r.ptr - t);
+    }
+
+    string_builder& append(char c) { return append(&c, 1); }
+
+    string_builder& push_back(char c) { return append(&c, 1); }
+
+    auto& operator+=(const string& s) { return append(s.begin(), s.size()); }
+
+    template<size_t N>
+    auto& operator+=(const char (&s)[N]) { return append(s, N-1); }
+
+    auto& operator+=(const char* s) { return append(s, strlen(s)); }
+
+    auto& operator+=(const slice<char>& s) { return append(s.begin(), s.size()); }
+
+    auto& operator+=(char c) { return push_back(c); }
+
+    // copies every chunk once into a string of exactly size() chars;
+    string build() const {
+        string s;
+        s.resize(len, uninit);
+        auto p = s.begin();
+        for (auto& c : chunks) {
+            memcpy(p, c.data.begin(), c.used);
+            p += c.used;
+        }
+        return s;
+    }
+
+    void write(std::ostream& out) const {
+        for (auto& c : chunks) out.write(c.data.begin(), c.used);
+    }
+
+#ifdef LIBZX_WRITEV
+    // writes every chunk to fd with as few system calls as writev allows, retrying short writes;
+    void write(int fd) const {
+        constexpr size_t batch = 64;
+        iovec v[batch];
+        for (auto c = chunks.begin(); c != chunks.end();) {
+            size_t n = 0;
+            for (; n < batch && c != chunks.end(); c++) {
+                if (c->used != 0) v[n++] = iovec{ c->data.begin(), c->used };
+            }
+            for (auto iov = v; n != 0;) {
+                auto r = writev(fd, iov, static_cast<int>(n));
+                if (r < 0) {
+                    if (errno == EINTR) continue;
+                    throw std::runtime_error("string_builder: cannot write: " + std::string(strerror(errno)));
+                }
+                auto w = static_cast<size_t>(r);
+                for (; n != 0 && w >= iov->iov_len; iov++, n--) w -= iov->iov_len;
+                if (n != 0) {
+                    iov->iov_base = static_cast<char*>(iov->iov_base) + w;
+                    iov->iov_len -= w;
+                }
+            }
+        }
+    }
+#endif
+
+    // keeps the chunks, so that building again allocates nothing until it outgrows them;
+    auto& clear() noexcept {
+        for (auto& c : chunks) c.used = 0;
+        current = 0, len = 0;
+        return *this;
+    }
+
+    size_t size() const noexcept { return len; }
+};
+
+inline auto& operator<<(std::ostream& out, const string_builder& b) {
+    b.write(out);
+    return out;
+}
+
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <bit>
+#include <memory>
 #include <optional>
 #include <stdexcept>
 #include <initializer_list>
@@ -8,33 +9,71 @@
 
 namespace libzx {
 
+// vector owns raw capacity, in which only the first len elements are constructed;
 template<typename T>
 class vector {
 protected:
-    unique_array<T> data;
-    size_t len = 0;
-    size_t cap() { return data.size(); }
+    T* data = nullptr;
+    size_t len = 0, space = 0;
+    size_t cap() { return space; }
+
+    static T* allocate(size_t n) { return std::allocator<T>().allocate(n); }
+    static void deallocate(T* p, size_t n) { if (p != nullptr) std::allocator<T>().deallocate(p, n); }
+
+    // moves the live elements into p, which holds new_cap slots, and adopts it;
+    void adopt(T* p, size_t new_cap) {
+        relocate(data, len, p);
+        deallocate(data, space);
+        data = p, space = new_cap;
+    }
 
     void grow(size_t size = 2) {
-        auto new_cap = std::bit_ceil(data.size() + size);
-        auto new_data = unique_array<T>(new_cap);
-        std::move(data.begin(), data.end(), new_data.begin());
-        data = std::move(new_data);
+        auto new_cap = std::bit_ceil(space + size);
+        adopt(allocate(new_cap), new_cap);
+    }
+
+    // destroys the elements from n on, or constructs them up to n, value-initialized or not;
+    // the storage must already hold n, so callers reserve first;
+    template<bool value>
+    void resize_within(size_t n) {
+        if (n < len) std::destroy(data + n, data + len);
+        else if constexpr (value) std::uninitialized_value_construct(data + len, data + n);
+        else std::uninitialized_default_construct(data + len, data + n);
+        len = n;
     }
+
+    // starts empty in space slots of storage owned by a derived class, such as small_vector;
+    vector(T* storage, size_t space, uninit_t) noexcept : data(storage), space(space) { }
 public:
-    vector(size_t len = 0, size_t min_cap = 16) : data(std::max(std::bit_ceil(len+1), min_cap)), len(len) {}
-    vector(std::initializer_list<T> l) : data(std::max(std::bit_ceil(l.size()+1), (size_t)16)), len(l.size()) {
-        std::move(l.begin(), l.end(), data.get());
+    vector() : data(allocate(16)), space(16) { }
+    vector(size_t len, size_t min_cap = 16) :
+        data(allocate(std::max(std::bit_ceil(len+1), min_cap))), len(len), space(std::max(std::bit_ceil(len+1), min_cap)) {
+        std::uninitialized_value_construct_n(data, len);
+    }
+    vector(std::initializer_list<T> l) :
+        data(allocate(std::max(std::bit_ceil(l.size()+1), (size_t)16))), len(l.size()), space(std::max(std::bit_ceil(l.size()+1), (size_t)16)) {
+        std::uninitialized_copy(l.begin(), l.end(), data);
+    }
+    vector(const slice<T>& s) :
+        data(allocate(std::max(std::bit_ceil(s.size()+1), (size_t)16))), len(s.size()), space(std::max(std::bit_ceil(s.size()+1), (size_t)16)) {
+        std::uninitialized_copy(s.begin(), s.end(), data);
     }
-    vector(const slice<T>& s) : data(std::max(std::bit_ceil(s.size()+1), (size_t)16)), len(s.size()) {
-        std::copy(s.begin(), s.end(), data.get());
+    vector(const vector& v) :
+        data(allocate(std::max(v.space, (size_t)16))), len(v.len), space(std::max(v.space, (size_t)16)) {
+        std::uninitialized_copy(v.begin(), v.end(), data);
+    }
+    vector(vector&& v) : data(v.data), len(v.len), space(v.space) { v.data = nullptr, v.len = v.space = 0; }
+
+    ~vector() {
+        std::destroy(data, data + len);
+        deallocate(data, space);
     }
-    vector(const vector& v) : data(v.data.clone()), len(v.len) { }
-    vector(vector&& v) : data(std::move(v.data)), len(v.len) { v.len = 0; }
 
     auto& operator=(const vector& v) {
         if (this != &v) {
-            data = v.data.clone();
+            clear();
+            reserve(v.len);
+            std::uninitialized_copy(v.begin(), v.end(), data);
             len = v.len;
         }
         return *this;
@@ -42,22 +81,68 @@ public:
 
     auto& operator=(vector&& v) noexcept {
         if (this != &v) {
-            data = std::move(v.data);
-            len = v.len;
-            v.len = 0;
+            std::swap(data, v.data);
+            std::swap(len, v.len);
+            std::swap(space, v.space);
         }
         return *this;
     }
 
     auto& push_back(convertible_to<T> auto&& t) {
-        if (len == cap()) grow();
-        data[len++] = std::forward<decltype(t)>(t);
+        return emplace_back(std::forward<decltype(t)>(t));
+    }
+
+    // constructs the element in place; when growing, it is built in the new buffer
+    // before the old one is released, so the arguments may refer to elements of this vector;
+    auto& emplace_back(auto&&... a) {
+        if (len == cap()) {
+            auto new_cap = std::bit_ceil(space + 2);
+            auto p = allocate(new_cap);
+            std::construct_at(p + len, std::forward<decltype(a)>(a)...);
+            adopt(p, new_cap);
+        } else {
+            std::construct_at(data + len, std::forward<decltype(a)>(a)...);
+        }
+        len++;
         return *this;
     }
 
-    auto& emplace_back(auto&&... a) { return push_back(T(a...)); }
+    T pop_back() {
+        if (len == 0) at(0);
+        T t = std::move(data[--len]);
+        std::destroy_at(data + len);
+        return t;
+    }
 
-    T pop_back() { return len > 0 ? std::move(data[--len]) : at(-1); }
+    auto& reserve(size_t n) {
+        if (n > space) adopt(allocate(n), n);
+        return *this;
+    }
+
+    // new elements are value-initialized;
+    auto& resize(size_t n) {
+        reserve(n);
+        resize_within<true>(n);
+        return *this;
+    }
+
+    // new elements are default-initialized, which leaves trivial types unwritten;
+    auto& resize(size_t n, uninit_t) {
+        reserve(n);
+        resize_within<false>(n);
+        return *this;
+    }
+
+    auto& shrink_to_fit() {
+        if (space > len) adopt(allocate(len), len);
+        return *this;
+    }
+
+    auto& clear() {
+        std::destroy(data, data + len);
+        len = 0;
+        return *this;
+    }
 
     T& operator[](size_t i) noexcept { return data[i]; }
 
@@ -70,10 +155,14 @@ public:
     }
 
     size_t size() const noexcept { return len; }
+    size_t capacity() const noexcept { return space; }
     T& front() { return data[0]; }
     T& back() { return data[len-1]; }
-    T* begin() const noexcept { return data.get(); }
-    T* end() const noexcept { return data.get() + len; }
+    T* begin() const noexcept { return data; }
+    T* end() const noexcept { return data + len; }
 };
 
+template<typename T>
+struct is_trivially_relocatable<vector<T>> : std::true_type {};
+
 }
@@ -0,0 +1,50 @@
+// g++ -std=c++20 -fsanitize=address,undefined -I. tests/frozen_hashmap.cpp && ./a.out
+#include <cstdio>
+#include "libzx/hashmap.hpp"
+#include "libzx/frozen_hashmap.hpp"
+
+using namespace libzx;
+
+static int failed = 0;
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failed++; } } while (0)
+
+int main() {
+    const char* path = "/tmp/libzx_frozen_hashmap_test.img";
+
+    // keys of another type are converted to K before they are hashed, when written and when looked up;
+    hashmap<int, int> ints;
+    for (int i = -50; i < 50; i++) ints.set(i, i * 2);
+    frozen_hashmap<uint32_t, int>::write(path, ints);
+    {
+        frozen_hashmap<uint32_t, int> f(path);
+        CHECK(f.size() == 100);
+        CHECK(f.contains(-1) && f.get(-1)->get() == -2);
+        CHECK(f.contains(uint32_t(-50)) && f.get(49)->get() == 98);
+        CHECK(!f.contains(50));
+    }
+
+    hashmap<uint32_t, int> small;
+    for (uint32_t i = 0; i < 100; i++) small.set(i, (int)i);
+    frozen_hashmap<float, int>::write(path, small);
+    {
+        frozen_hashmap<float, int> f(path);
+        CHECK(f.get(7) && f.get(7)->get() == 7);
+        CHECK(f.get(7.0f) && !f.contains(7.5f));
+    }
+
+    // string keys are hashed from their chars, whatever holds them;
+    hashmap<string, int> words;
+    words.set(string("hello"), 1);
+    words.set(string("world"), 2);
+    frozen_hashmap<string, int>::write(path, words);
+    {
+        frozen_hashmap<string, int> f(path);
+        char buf[] = "world";
+        CHECK(f.get("hello")->get() == 1 && f.get(string("hello"))->get() == 1);
+        CHECK(f.get(slice<char>(buf, 0, 5))->get() == 2 && !f.contains("nope"));
+    }
+    remove(path);
+
+    if (failed == 0) printf("ok\n");
+    return failed != 0;
+}
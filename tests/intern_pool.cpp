@@ -0,0 +1,39 @@
+// g++ -std=c++20 -fsanitize=address,undefined -I. tests/intern_pool.cpp && ./a.out
+#include <cstdio>
+#include <cstring>
+#include "libzx/intern_pool.hpp"
+
+using namespace libzx;
+
+static int failed = 0;
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failed++; } } while (0)
+
+int main() {
+    intern_pool pool;
+    // a string longer than a block, then short ones, which must still fit in a block of their own;
+    string big;
+    for (size_t i = 0; i < 100000; i++) big.push_back(static_cast<char>('a' + i % 26));
+    auto b = pool.intern(big);
+    auto abc = pool.intern("abc");
+    CHECK(pool.view(b).size() == big.size() && memcmp(pool.c_str(b), big.begin(), big.size()) == 0);
+    CHECK(strcmp(pool.c_str(abc), "abc") == 0);
+
+    // many short strings, with another long one between them, fill several blocks;
+    char t[32];
+    intern_pool::id ids[20000];
+    for (int i = 0; i < 20000; i++) {
+        snprintf(t, sizeof(t), "key-%d", i);
+        ids[i] = pool.intern(t);
+        if (i == 10000) pool.intern(big + "x");
+    }
+    for (int i = 0; i < 20000; i++) {
+        snprintf(t, sizeof(t), "key-%d", i);
+        CHECK(strcmp(pool.c_str(ids[i]), t) == 0);
+        CHECK(pool.find(t) == ids[i]);
+    }
+    CHECK(pool.intern(big) == b && pool.intern("abc") == abc);
+    CHECK(pool.size() == 20003);
+
+    if (failed == 0) printf("ok\n");
+    return failed != 0;
+}
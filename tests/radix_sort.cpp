@@ -0,0 +1,64 @@
+// g++ -std=c++20 -fsanitize=address,undefined -I. tests/radix_sort.cpp && ./a.out
+#include <cstdio>
+#include <random>
+#include "libzx/radix_sort.hpp"
+
+using namespace libzx;
+
+static int failed = 0;
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failed++; } } while (0)
+
+// radix_sort must put strings in the order of sort, including chars of 0x80 and above;
+template<typename S>
+void agree(std::mt19937_64& g, size_t n, size_t len) {
+    vector<string> chars;
+    for (size_t i = 0; i < n; i++) {
+        string c;
+        for (size_t j = 0; j < len; j++) c.push_back(static_cast<char>(g() % 4 == 0 ? 0x61 + g() % 26 : g() % 256));
+        chars.push_back(c);
+    }
+    vector<S> a, b;
+    for (auto& c : chars) {
+        if constexpr (std::same_as<S, string>) a.push_back(c);
+        else a.push_back(slice<char>(c));
+    }
+    for (auto& x : a) b.push_back(x);
+    radix_sort(slice<S>(a));
+    sort(slice<S>(b));
+    bool same = true;
+    for (size_t i = 0; i < n; i++) same = same && a[i] == b[i];
+    CHECK(same);
+}
+
+int main() {
+    std::mt19937_64 g(1);
+    char c[4][2] = { "\x61", "\x7a", "\x80", "\xc3" };
+    vector<slice<char>> s;
+    for (auto i : { 2, 0, 3, 1 }) s.push_back(slice<char>(c[i], 0, 1));
+    radix_sort(slice<slice<char>>(s));
+    for (size_t i = 1; i < s.size(); i++) CHECK(s[i - 1] < s[i]);
+
+    for (size_t n : { 10, 100, 5000 }) {
+        for (size_t len : { 1, 3, 16 }) {
+            agree<slice<char>>(g, n, len);
+            agree<string>(g, n, len);
+        }
+    }
+
+    // the strings are all 'a' but for a 'b', each at another position, given out of order, so each byte splits off
+    // one string and leaves the rest in one bucket, which msd must loop on rather than recurse into once per byte;
+    size_t n = 4000;
+    vector<string> deep;
+    for (size_t i = 0; i < n; i++) {
+        string d;
+        for (size_t j = 0; j < n; j++) d.push_back(j == (i * 7919) % n ? 'b' : 'a');
+        deep.push_back(d);
+    }
+    radix_sort(slice<string>(deep));
+    bool ordered = true;
+    for (size_t i = 1; i < n; i++) ordered = ordered && deep[i - 1] < deep[i];
+    CHECK(ordered);
+
+    if (failed == 0) printf("ok\n");
+    return failed != 0;
+}
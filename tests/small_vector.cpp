@@ -0,0 +1,35 @@
+// g++ -std=c++20 -fsanitize=address,undefined -I. tests/small_vector.cpp && ./a.out
+#include <cstdio>
+#include "libzx/small_vector.hpp"
+#include "libzx/string.hpp"
+
+using namespace libzx;
+
+static int failed = 0;
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failed++; } } while (0)
+
+int main() {
+    // the size constructor resizes, and must build its elements on the heap once they outgrow the buffer;
+    small_vector<long, 4> s(100);
+    CHECK(s.size() == 100);
+    bool zero = true;
+    for (auto x : s) zero = zero && x == 0;
+    CHECK(zero);
+
+    small_vector<long, 4> t;
+    t.resize(3);
+    t[2] = 7;
+    t.resize(1000, uninit);
+    CHECK(t.size() == 1000 && t[2] == 7);
+    t.resize(2);
+    t.shrink_to_fit();
+    CHECK(t.size() == 2 && t[0] == 0);
+
+    small_vector<string, 2> u;
+    u.push_back(string("kept"));
+    u.resize(50);
+    CHECK(u.size() == 50 && u[0] == string("kept") && u[49].size() == 0);
+
+    if (failed == 0) printf("ok\n");
+    return failed != 0;
+}
@@ -0,0 +1,34 @@
+// g++ -std=c++20 -fsanitize=address,undefined -I. tests/vector.cpp && ./a.out
+#include <cstdio>
+#include "libzx/vector.hpp"
+#include "libzx/string.hpp"
+
+using namespace libzx;
+
+static int failed = 0;
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #c); failed++; } } while (0)
+
+int main() {
+    // resize must construct the new elements in the storage it grows into, not the old one;
+    vector<long> v;
+    v.resize(100);
+    CHECK(v.size() == 100 && v.capacity() >= 100);
+    bool zero = true;
+    for (auto x : v) zero = zero && x == 0;
+    CHECK(zero);
+    for (size_t i = 0; i < v.size(); i++) v[i] = (long)i;
+    v.resize(5000, uninit);
+    CHECK(v.size() == 5000 && v[99] == 99);
+    v.resize(10);
+    CHECK(v.size() == 10 && v[9] == 9);
+
+    vector<string> s;
+    s.push_back(string("kept"));
+    s.resize(1000);
+    CHECK(s.size() == 1000 && s[0] == string("kept") && s[999].size() == 0);
+    s.resize(3, uninit);
+    CHECK(s.size() == 3 && s[0] == string("kept"));
+
+    if (failed == 0) printf("ok\n");
+    return failed != 0;
+}